@@ -1,5 +1,7 @@
 #pragma once
 
+#include <Eigen/Core>
+#include <unsupported/Eigen/AutoDiff>
 #include "common_cpp/common.h"
 #include "common_cpp/quaternion.h"
 
@@ -29,112 +31,251 @@ enum
 };
 
 // Convenient definitions
-typedef Eigen::Matrix<double, NUM_STATES, 1> xVector, dxVector;
-typedef Eigen::Matrix<double, COMMAND_SIZE, 1> uVector;
+template<typename T> using xVector = Eigen::Matrix<T, NUM_STATES, 1>;
+template<typename T> using dxVector = Eigen::Matrix<T, NUM_STATES, 1>;
+template<typename T> using uVector = Eigen::Matrix<T, COMMAND_SIZE, 1>;
 
+template<typename T>
 struct State
 {
 
-  Eigen::Vector3d p;
-  double v;
-  double psi; // heading
-  double theta; // steering angle
+  Eigen::Matrix<T,3,1> p;
+  T v;
+  T psi; // heading
+  T theta; // steering angle
 
   State()
   {
     p.setZero();
-    v = 0;
-    psi = 0;
-    theta =0;
+    v = T(0);
+    psi = T(0);
+    theta = T(0);
   }
 
-  State(const xVector &x0)
+  State(const xVector<T> &x0)
   {
-    p = x0.segment<3>(PX);
+    p = x0.template segment<3>(PX);
     v = x0(VEL);
     psi = x0(PSI);
     theta = x0(THETA);
   }
 
-  State operator+(const dxVector &delta) const
+  State operator+(const dxVector<T> &delta) const
   {
     State x;
-    x.p = p + delta.segment<3>(PX);
+    x.p = p + delta.template segment<3>(PX);
     x.v = v + delta(VEL);
     x.psi = psi + delta(PSI);
     x.theta = theta + delta(THETA);
     return x;
   }
 
-  void operator+=(const dxVector &delta)
+  void operator+=(const dxVector<T> &delta)
   {
     *this = *this + delta;
   }
 
-  Eigen::Matrix<double, NUM_STATES, 1> toEigen() const
+  xVector<T> toEigen() const
   {
-    Eigen::Matrix<double, NUM_STATES, 1> x;
+    xVector<T> x;
     x << p, v, psi, theta;
     return x;
   }
 
+  template<typename T2>
+  State<T2> cast() const
+  {
+    return State<T2>(toEigen().template cast<T2>());
+  }
+
 };
 
-inline void rk4(std::function<void(const State&, const uVector&, dxVector&)> f,
-                                   const double& dt, const State& x, const uVector& u, dxVector& dx)
+typedef State<float> Statef;
+typedef State<double> Stated;
+
+template<typename T>
+inline void rk4(std::function<void(const State<T>&, const uVector<T>&, dxVector<T>&)> f,
+                                   const T& dt, const State<T>& x, const uVector<T>& u, dxVector<T>& dx)
 {
-  dxVector k1, k2, k3, k4;
+  dxVector<T> k1, k2, k3, k4;
   f(x, u, k1);
-  f(x + k1 * dt / 2, u, k2);
-  f(x + k2 * dt / 2, u, k3);
+  f(x + k1 * dt / T(2), u, k2);
+  f(x + k2 * dt / T(2), u, k3);
   f(x + k3 * dt, u, k4);
-  dx = (k1 + 2 * k2 + 2 * k3 + k4) * dt / 6.0;
+  dx = (k1 + T(2) * k2 + T(2) * k3 + k4) * dt / T(6);
 }
 
 
+// Scalar type T is float or double for simulation. Dynamics are also usable
+// with dual numbers, which is how jacobians() differentiates f exactly.
+template<typename T>
 class Bicycle
 {
 
 public:
 
-  Bicycle();
-  Bicycle(const std::string &filename);
-  ~Bicycle();
+  Bicycle() : t_prev_(-1)
+  {
+    x_err_.setZero();
+    vw_.setZero();
+  }
+
+  Bicycle(const std::string &filename)
+    : t_prev_(-1)
+  {
+    load(filename);
+  }
+
+  ~Bicycle() {}
+
+  void load(const std::string &filename)
+  {
+    // Load all parameters
+    xVector<double> x0;
+    common::get_yaml_node("name", filename, name_);
+    common::get_yaml_node("mass", filename, mass_);
+    common::get_yaml_node("inertia", filename, inertia_);
+    common::get_yaml_node("length", filename, L_);
+    common::get_yaml_node("max_force", filename, max_force_);
+    common::get_yaml_node("max_torque", filename, max_torque_);
+    common::get_yaml_node("max_steering_angle", filename, max_steering_angle_);
+    common::get_yaml_node("drag", filename, drag_);
+    common::get_yaml_eigen<xVector<double>>("x0", filename, x0);
+
+    u_.setZero();
+    x_ = State<T>(x0.cast<T>());
+    x_err_.setZero();
+    dx_.setZero();
+    vw_.setZero();
+  }
+
+  // Each step's increment is tiny next to the state, so adding it to a float
+  // state would round much of it away. Increments are summed with Kahan
+  // compensation instead, carrying the lost low-order bits in x_err_.
+  void propagate(const double &t)
+  {
+    // Time step
+    double dt = t - t_prev_;
+    if (t_prev_ != t) t_prev_ = t;
+
+    if (t > 0 && dt > 0)
+    {
+      // 4th order Runge-Kutta integration
+      rk4<T>(std::bind(&Bicycle::f, this,
+                       std::placeholders::_1,std::placeholders::_2, std::placeholders::_3),
+                       T(dt), x_, u_, dx_);
+      xVector<T> x = x_.toEigen();
+      dxVector<T> y = dx_ - x_err_;
+      xVector<T> x_new = x + y;
+      x_err_ = (x_new - x) - y;
+
+      // Wrap angles and enforce steering limits, dropping the compensation of a clamped angle
+      x_new(PSI) = common::wrapAngle(x_new(PSI), T(M_PI));
+      T theta = common::saturate(x_new(THETA), max_steering_angle_, -max_steering_angle_);
+      if (theta != x_new(THETA))
+      {
+        x_new(THETA) = theta;
+        x_err_(THETA) = T(0);
+      }
+      x_ = State<T>(x_new);
+    }
+  }
+
+  void f(const State<T>& x, const uVector<T>& u, dxVector<T>& dx) const
+  {
+    using std::cos;
+    using std::sin;
+    using std::tan;
+    dx(PX) = x.v * cos(x.psi);
+    dx(PY) = x.v * sin(x.psi);
+    dx(PZ) = T(0);
+    dx(PSI) = x.v * tan(x.theta) / L_;
+    dx(VEL) = u(FORCE) / mass_ - drag_ * (x.v - vw_(PX) * cos(x.psi) - vw_(PY) * sin(x.psi)); // drag on airspeed
+    dx(THETA) = u(TORQUE) / inertia_;
+  }
+
+  // Exact Jacobians of f with respect to state (A) and input (B) via forward-mode dual numbers
+  void jacobians(const State<T>& x, const uVector<T>& u,
+                 Eigen::Matrix<T, NUM_STATES, NUM_STATES>& A,
+                 Eigen::Matrix<T, NUM_STATES, COMMAND_SIZE>& B) const
+  {
+    typedef Eigen::AutoDiffScalar<Eigen::Matrix<T, NUM_STATES+COMMAND_SIZE, 1>> Dual;
+
+    xVector<Dual> x_dual = x.toEigen().template cast<Dual>();
+    uVector<Dual> u_dual = u.template cast<Dual>();
+    for (int i = 0; i < NUM_STATES; ++i)
+      x_dual(i).derivatives() = Eigen::Matrix<T, NUM_STATES+COMMAND_SIZE, 1>::Unit(i);
+    for (int i = 0; i < COMMAND_SIZE; ++i)
+      u_dual(i).derivatives() = Eigen::Matrix<T, NUM_STATES+COMMAND_SIZE, 1>::Unit(NUM_STATES+i);
+
+    dxVector<Dual> dx_dual;
+    cast<Dual>().f(State<Dual>(x_dual), u_dual, dx_dual);
+    for (int i = 0; i < NUM_STATES; ++i)
+    {
+      A.row(i) = dx_dual(i).derivatives().template head<NUM_STATES>().transpose();
+      B.row(i) = dx_dual(i).derivatives().template tail<COMMAND_SIZE>().transpose();
+    }
+  }
+
+  template<typename T2>
+  Bicycle<T2> cast() const
+  {
+    Bicycle<T2> b;
+    b.name_ = name_;
+    b.u_ = u_.template cast<T2>();
+    b.x_ = x_.template cast<T2>();
+    b.x_err_ = x_err_.template cast<T2>();
+    b.dx_ = dx_.template cast<T2>();
+    b.vw_ = vw_.template cast<T2>();
+    b.t_prev_ = t_prev_;
+    b.mass_ = T2(mass_);
+    b.inertia_ = T2(inertia_);
+    b.L_ = T2(L_);
+    b.max_force_ = T2(max_force_);
+    b.max_torque_ = T2(max_torque_);
+    b.max_steering_angle_ = T2(max_steering_angle_);
+    b.drag_ = T2(drag_);
+    return b;
+  }
+
+  void setWind(const Eigen::Vector3d& vw) { vw_ = vw.cast<T>(); }
 
-  void load(const std::string &filename);
-  void propagate(const double &t);
-  
   const std::string& name() const { return name_; }
-  const State& state() const { return x_; }
-  const double& x() const { return x_.p(0); }
-  const double& y() const { return x_.p(1); }
-  const double& psi() const { return x_.psi; }
-  const double& theta() const { return x_.theta; }
-  double& force() { return u_(0); }
-  double& torque() { return u_(1); }
-  const double& max_force() const { return max_force_; }
-  const double& max_torque() const { return max_torque_; }
+  const State<T>& state() const { return x_; }
+  const T& x() const { return x_.p(0); }
+  const T& y() const { return x_.p(1); }
+  const T& psi() const { return x_.psi; }
+  const T& theta() const { return x_.theta; }
+  T& force() { return u_(0); }
+  T& torque() { return u_(1); }
+  const T& max_force() const { return max_force_; }
+  const T& max_torque() const { return max_torque_; }
 
 
 private:
 
-  void f(const State& x, const uVector& u, xVector& dx);
+  template<typename T2> friend class Bicycle;
 
   std::string name_;
-  uVector u_;
-  State x_;
-  dxVector dx_;
+  uVector<T> u_;
+  State<T> x_;
+  dxVector<T> x_err_; // rounding error of x_ not yet added back, for compensated summation
+  dxVector<T> dx_;
+  Eigen::Matrix<T,3,1> vw_; // wind velocity at the vehicle
 
   double t_prev_;
-  double mass_;
-  double inertia_;
-  double L_;
-  double max_force_;
-  double max_torque_;
-  double max_steering_angle_;
-  double drag_;
+  T mass_;
+  T inertia_;
+  T L_;
+  T max_force_;
+  T max_torque_;
+  T max_steering_angle_;
+  T drag_;
 
 };
 
+typedef Bicycle<float> Bicyclef;
+typedef Bicycle<double> Bicycled;
+
 
 } // namespace bicycle
@@ -1,9 +1,11 @@
 #pragma once
 
 #include <fstream>
+#include <stdexcept>
 #include "common_cpp/common.h"
 #include "common_cpp/logger.h"
-#include "vehicle.h"
+#include "bicycle.h"
+#include "route.h"
 
 using namespace Eigen;
 
@@ -12,41 +14,105 @@ namespace bicycle_ctrl_pid
 {
 
 
+template<typename T>
 class Controller
 {
 
 public:
 
-  Controller();
-  Controller(const std::string &filename, const std::string& name);
-  ~Controller();
-
-  void load(const std::string &filename, const std::string& name);
-  void computeControl(const bicycle::State& x);
-
-  const bicycle::uVector& u() const { return u_; }
+  Controller()  : t_prev_(0.0), lookahead_distance_(5.0) {}
+
+  Controller(const std::string &filename, const std::string& name)
+    : t_prev_(0.0), lookahead_distance_(5.0)
+  {
+    load(filename, name);
+  }
+
+  ~Controller() {}
+
+  void load(const std::string &filename, const std::string& name)
+  {
+    // Load all parameters
+    common::get_yaml_node("mass", filename, mass_);
+    common::get_yaml_node("inertia", filename, inertia_);
+    common::get_yaml_node("length", filename, L_);
+    common::get_yaml_node("max_force", filename, max_force_);
+    common::get_yaml_node("max_torque", filename, max_torque_);
+    common::get_yaml_node("max_steering_angle", filename, max_steering_angle_);
+    common::get_yaml_node("k_u", filename, ku_);
+    common::get_yaml_node("k_theta", filename, ktheta_);
+    common::get_yaml_node("k_psi", filename, kpsi_);
+    common::get_yaml_node("velocity_command", filename, vel_cmd_);
+
+    // Load route from file, or close the inline waypoints into a loop
+    std::string route_file;
+    std::vector<double> loaded_wps;
+    common::get_yaml_node("lookahead_distance", filename, lookahead_distance_);
+    common::get_yaml_node("route_file", filename, route_file);
+    if (!route_file.empty())
+    {
+      route_.load(route_file);
+    }
+    else if (common::get_yaml_node("waypoints", filename, loaded_wps))
+    {
+      int num_waypoints = std::floor(loaded_wps.size()/2.0);
+      route_.set(Eigen::Map<Eigen::MatrixXd>(loaded_wps.data(), 2, num_waypoints), true);
+    }
+    if (route_.empty())
+      throw std::runtime_error("bicycle_ctrl_pid: " + filename + " needs a route_file or waypoints");
+
+    // Initialize logger
+    std::stringstream ss;
+    ss << "/tmp/" << name << "_command.log";
+    command_log_.open(ss.str());
+  }
+
+  void computeControl(const bicycle::State<T>& x)
+  {
+    using std::atan;
+    using std::atan2;
+
+    // Cosntant velocity doesn't care about waypoints
+    u_(bicycle::FORCE) = common::saturate(-ku_ * mass_ * (x.v - vel_cmd_), max_force_, -max_force_);
+
+    // Turn the vehicle toward the pure pursuit target ahead on the route
+    route_.update(x.p.template segment<2>(bicycle::PX).template cast<double>());
+    wp_ = route_.lookahead(lookahead_distance_).cast<T>();
+    T psi_d = atan2(wp_(bicycle::PY) - x.p(bicycle::PY), wp_(bicycle::PX) - x.p(bicycle::PX));
+    T psi_err = common::wrapAngle(T(x.psi - psi_d), T(M_PI));
+    T theta_d = common::saturate(T(atan(-kpsi_ * L_ / x.v * psi_err)), max_steering_angle_, -max_steering_angle_);
+    u_(bicycle::TORQUE) = common::saturate(-ktheta_ * inertia_ * (x.theta - theta_d), max_torque_, -max_torque_);
+  }
+
+  const bicycle::uVector<T>& u() const { return u_; }
 
 private:
 
-  void updateWaypoint(const bicycle::State& x);
-  void log(const double &t);
+  void log(const double &t)
+  {
+    command_log_.log(t);
+    command_log_.logMatrix(u_);
+    command_log_.logMatrix(wp_);
+  }
 
-  bicycle::uVector u_;
+  bicycle::uVector<T> u_;
 
-  bool initialized_;
-  double mass_, inertia_, max_force_, max_torque_, max_steering_angle_, L_, t_prev_;
-  double ku_, ktheta_, kpsi_;
-  double vel_cmd_;
+  T mass_, inertia_, max_force_, max_torque_, max_steering_angle_, L_;
+  double t_prev_;
+  T ku_, ktheta_, kpsi_;
+  T vel_cmd_;
 
   common::Logger command_log_;
 
-  // Waypoint Parameters
-  MatrixXd waypoints_;
-  int current_waypoint_id_;
-  double waypoint_threshold_;
-  Vector2d wp_;
+  // Route Parameters
+  route::Route route_;
+  double lookahead_distance_;
+  Eigen::Matrix<T,2,1> wp_; // current target point
 
 };
 
+typedef Controller<float> Controllerf;
+typedef Controller<double> Controllerd;
+
 
 } // namespace bicycle_ctrl_pid
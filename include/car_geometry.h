@@ -0,0 +1,84 @@
+#pragma once
+
+#include <string>
+#include "common_cpp/common.h"
+#include "common_cpp/transform.h"
+
+
+namespace car_geometry
+{
+
+
+// Scene region both backends draw, widened to the aspect ratio of the output
+const float SCENE_X_MIN = -100.0;
+const float SCENE_X_MAX = 100.0;
+const float SCENE_Y_MIN = -100.0;
+const float SCENE_Y_MAX = 100.0;
+
+
+// Car length drawn by both backends, read from the vehicle's parameter file
+const float DEFAULT_CAR_LENGTH = 4.0;
+
+inline float carLength(const std::string& filename)
+{
+  float car_length = DEFAULT_CAR_LENGTH;
+  common::get_yaml_node("length", filename, car_length);
+  return car_length;
+}
+
+
+// Body outline and tire outlines (front-left, front-right, rear-right, rear-left)
+// as columns of vertices in the drawing frame
+struct CarPolygons
+{
+  Eigen::Matrix<float,3,8> body;
+  Eigen::Matrix<float,3,4> tires[4];
+};
+
+
+// Car polygons at position (px, py) with heading psi and steering angle theta,
+// shared by the OpenGL animator and the software rasterizer so both draw the same shapes
+inline void carPolygons(const float& car_length, const double& px, const double& py,
+                        const double& psi, const double& theta, CarPolygons& polygons)
+{
+  const float car_width = 0.5*car_length;
+  const float tire_length = 0.3*car_length;
+  const float tire_width = 0.4*tire_length;
+
+  // Define body and tire vertices in GL frame (x-forward, y-left) at identity
+  Eigen::Matrix<float,3,8> body;
+  body.col(0) << 0.6*car_length,  0.5*car_width, 0.0; // vertex body front-left square
+  body.col(1) << 1.0*car_length,  0.3*car_width, 0.0; // vertex body front-left trapezoid
+  body.col(2) << 1.0*car_length, -0.3*car_width, 0.0; // vertex body front-right trapezoid
+  body.col(3) << 0.6*car_length, -0.5*car_width, 0.0; // vertex body front-right square
+  body.col(4) << 0.2*car_length, -0.5*car_width, 0.0; // vertex body rear-right square
+  body.col(5) << 0.0*car_length, -0.4*car_width, 0.0; // vertex body rear-right trapezoid
+  body.col(6) << 0.0*car_length,  0.4*car_width, 0.0; // vertex body rear-left trapezoid
+  body.col(7) << 0.2*car_length,  0.5*car_width, 0.0; // vertex body rear-left square
+  Eigen::Matrix<float,3,4> tire;
+  tire.col(0) <<  0.5*tire_length,  0.5*tire_width, 0.0; // vertex tire front-left
+  tire.col(1) <<  0.5*tire_length, -0.5*tire_width, 0.0; // vertex tire front-right
+  tire.col(2) << -0.5*tire_length, -0.5*tire_width, 0.0; // vertex tire rear-right
+  tire.col(3) << -0.5*tire_length,  0.5*tire_width, 0.0; // vertex tire rear-left
+  Eigen::Matrix<float,3,4> tire_center;
+  tire_center.col(0) << 1.0*car_length,  0.5*car_width, 0.0; // tire center front-left
+  tire_center.col(1) << 1.0*car_length, -0.5*car_width, 0.0; // tire center front-right
+  tire_center.col(2) << 0.0*car_length, -0.5*car_width, 0.0; // tire center rear-right
+  tire_center.col(3) << 0.0*car_length,  0.5*car_width, 0.0; // tire center rear-left
+
+  // Actively tranform all vertices to align with simulation, front tires also steer
+  common::Transformf x_GL_to_b(Eigen::Vector3f(px, py, 0), common::Quaternionf(0, 0, common::wrapAngle(-psi+M_PI/2,M_PI)));
+  common::Quaternionf q_theta(0, 0, theta);
+  common::Quaternionf q_identity(0, 0, 0);
+  for (int i = 0; i < 8; ++i)
+    polygons.body.col(i) = x_GL_to_b.inv().transform(body.col(i));
+  for (int j = 0; j < 4; ++j)
+  {
+    const common::Quaternionf& q = j < 2 ? q_theta : q_identity;
+    for (int i = 0; i < 4; ++i)
+      polygons.tires[j].col(i) = x_GL_to_b.inv().transform(Eigen::Vector3f(tire_center.col(j) + q.rot(tire.col(i))));
+  }
+}
+
+
+} // namespace car_geometry
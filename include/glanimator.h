@@ -16,6 +16,7 @@
 #pragma once
 
 #include <chrono>
+#include "car_geometry.h"
 
 
 namespace glanimator
@@ -42,16 +43,13 @@ private:
     std::chrono::high_resolution_clock::time_point t0; // Initial time for measuring actual time
 
 	// These variables set the dimensions of the rectanglar region we wish to view.
-	const float x_min = -100.0;
-    const float x_max =  100.0;
-	const float y_min = -100.0;
-    const float y_max =  100.0;
+	const float x_min = car_geometry::SCENE_X_MIN;
+    const float x_max = car_geometry::SCENE_X_MAX;
+	const float y_min = car_geometry::SCENE_Y_MIN;
+    const float y_max = car_geometry::SCENE_Y_MAX;
 
     // Car dimensions
-    float car_length = 4.0;
-    const float car_width = 0.5*car_length;
-    const float tire_length = 0.3*car_length;
-    const float tire_width = 0.4*tire_length;
+    float car_length = car_geometry::DEFAULT_CAR_LENGTH;
 
 };
 
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <Eigen/Core>
+
+
+namespace rasterizer
+{
+
+
+// Pack a color as RGBA bytes in memory order
+inline uint32_t rgb(const float& r, const float& g, const float& b)
+{
+  return uint32_t(255 * r) | uint32_t(255 * g) << 8 | uint32_t(255 * b) << 16 | 0xff000000u;
+}
+
+
+// Vehicle pose in the drawing frame, same convention as GLanimator::drawScene
+struct Frame
+{
+  double t;
+  double px;
+  double py;
+  double psi;
+  double theta;
+};
+
+
+class Framebuffer
+{
+
+public:
+
+  Framebuffer();
+  Framebuffer(const int& width, const int& height);
+
+  void resize(const int& width, const int& height);
+  void clear(const uint32_t& color);
+  void fillPolygon(const Eigen::Matrix<float,2,Eigen::Dynamic>& vertices, const uint32_t& color);
+  void writePPM(const std::string& filename) const;
+
+  const int& width() const { return width_; }
+  const int& height() const { return height_; }
+  const std::vector<uint32_t>& pixels() const { return pixels_; }
+
+private:
+
+  void fillSpan(uint32_t* row, int x0, const int& x1, const uint32_t& color);
+
+  int width_;
+  int height_;
+  std::vector<uint32_t> pixels_;
+
+};
+
+
+// CPU counterpart of GLanimator for headless runs. Draws the same scene into a
+// framebuffer and writes numbered PPM images, one frame per worker thread.
+// Sequences can be rendered in batches by continuing the numbering at first_index.
+class Rasterizer
+{
+
+public:
+
+  Rasterizer();
+  Rasterizer(const std::string& filename, const int& width, const int& height);
+
+  void load(const std::string& filename, const int& width, const int& height);
+  void render(const Frame& frame, Framebuffer& fb) const;
+  void renderSequence(const std::vector<Frame>& frames, const std::string& prefix,
+                      const size_t& first_index = 0, int num_threads = 0) const;
+
+private:
+
+  Eigen::Vector2f toPixel(const Eigen::Vector3f& v) const;
+
+  int width_;
+  int height_;
+  float car_length_;
+
+  // Visible region, the scene box of GLanimator widened to the image aspect ratio
+  float x_min_, x_max_, y_min_, y_max_;
+
+};
+
+
+} // namespace rasterizer
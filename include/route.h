@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <Eigen/Core>
+
+
+namespace route
+{
+
+
+/*
+ * Polyline route with progress-aware nearest point tracking.
+ *
+ * Each update warm starts from the previously matched segment and only searches
+ * a window of arc length around it, so the cost per step depends on vehicle
+ * speed and vertex spacing, not on route length. A uniform grid over the
+ * segments is only used to find the route initially or recover after the
+ * vehicle strays from the window. While the vehicle stays far from the route,
+ * the global search is only repeated each time it travels the relocalize
+ * distance.
+ *
+ * Route files are binary: a uint64 vertex count followed by that many
+ * (north, east) float64 pairs. Routes whose last vertex repeats the first are
+ * closed loops.
+ */
+class Route
+{
+
+public:
+
+  Route();
+  Route(const std::string& filename);
+  ~Route();
+
+  void load(const std::string& filename);
+  void set(const Eigen::Matrix<double,2,Eigen::Dynamic>& vertices, const bool& closed);
+  void update(const Eigen::Vector2d& p);
+  void setSearch(const double& search_distance, const double& relocalize_distance);
+
+  Eigen::Vector2d lookahead(const double& distance) const;
+  double crossTrackError() const { return cross_track_error_; }
+  double heading() const { return heading_; }
+  double progress() const { return s_nearest_; }
+  double length() const { return empty() ? 0.0 : s_.back(); }
+  bool empty() const { return vertices_.cols() == 0; }
+  int segment() const { return segment_; }
+  const Eigen::Vector2d& nearest() const { return nearest_; }
+
+private:
+
+  int numSegments() const { return closed_ ? vertices_.cols() : vertices_.cols() - 1; }
+  int next(const int& i) const { return (i + 1) % vertices_.cols(); }
+  double project(const int& i, const Eigen::Vector2d& p, double& frac) const;
+  void match(const int& i, const double& frac, const Eigen::Vector2d& p);
+  void relocalize(const Eigen::Vector2d& p);
+  void buildIndex();
+  uint64_t cellKey(const int& ix, const int& iy) const;
+
+  Eigen::Matrix<double,2,Eigen::Dynamic> vertices_;
+  std::vector<double> s_; // arc length at each vertex, with total length last
+  bool closed_;
+  bool initialized_;
+  double search_distance_; // maximum arc length searched around the last match (m)
+  double relocalize_distance_; // distance from the route that triggers a global search (m)
+
+  // Current match
+  int segment_;
+  double s_nearest_;
+  double cross_track_error_;
+  double heading_;
+  Eigen::Vector2d nearest_;
+
+  // Travel since the last global search
+  Eigen::Vector2d p_prev_;
+  double moved_;
+
+  // Grid index of (cell key, segment) pairs sorted by key
+  double cell_size_;
+  Eigen::Vector2d origin_;
+  int cells_x_, cells_y_;
+  std::vector<std::pair<uint64_t, int>> cells_;
+
+};
+
+
+} // namespace route
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+
+namespace scheduler
+{
+
+
+// Execution stages, run in this order when tasks are due on the same tick
+enum
+{
+  ENVIRONMENT,
+  DYNAMICS,
+  SENSORS,
+  ESTIMATION,
+  CONTROL,
+  LOGGING,
+  NUM_STAGES
+};
+
+
+// Discrete-event scheduler for components running at different rates. Time is
+// counted in integer ticks of the base time step and every period is a whole
+// number of ticks, so wake-ups never drift; add() rejects rates that would
+// need rounding, including rates faster than the base step. Pending
+// wake-ups live in a binary heap ordered by (tick, stage, task id), so only due
+// tasks are touched and ties always resolve the same way. Tasks due on the same
+// tick and stage (e.g. the controllers of different vehicles) must be
+// independent of each other, as they are run in parallel. Components they
+// share, such as the wind field, must lock their own state or be run from a
+// task in a stage of their own. An exception thrown by a task is rethrown from
+// run() once the rest of its batch has finished, leaving the schedule intact.
+class Scheduler
+{
+
+public:
+
+  Scheduler();
+  Scheduler(const double &dt);
+  ~Scheduler();
+
+  void init(const double &dt);
+  int add(const std::string& name, const double& rate, const int& stage,
+          std::function<void(const double&)> callback, const double& phase = 0);
+  void run(const double &t);
+
+  double time() const { return tick_ * dt_; }
+  const std::string& name(const int& id) const { return tasks_[id].name; }
+
+private:
+
+  struct Task
+  {
+    std::string name;
+    uint64_t period; // ticks between wake-ups
+    int stage;
+    std::function<void(const double&)> callback;
+  };
+
+  struct Event
+  {
+    uint64_t tick;
+    int stage;
+    int id;
+
+    // Inverted so the standard max-heap algorithms yield the earliest event
+    bool operator<(const Event& other) const
+    {
+      if (tick != other.tick) return tick > other.tick;
+      if (stage != other.stage) return stage > other.stage;
+      return id > other.id;
+    }
+  };
+
+  double dt_;
+  uint64_t tick_; // last tick processed
+  std::vector<Task> tasks_;
+  std::vector<Event> events_; // heap of pending wake-ups
+  std::vector<Event> batch_; // events due together on the current tick and stage
+
+};
+
+
+} // namespace scheduler
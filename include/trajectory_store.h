@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+#include <Eigen/Core>
+
+
+namespace trajectory_store
+{
+
+
+/*
+ * Columnar trajectory file shared by many runs and vehicles.
+ *
+ * Each writer logs one run. Its rows (time followed by data channels) are
+ * buffered per vehicle and written out in chunks, one compressed block per column. Time is stored with
+ * delta-of-delta encoding of its bit pattern and every other channel with XOR
+ * float encoding, which both collapse to a few bits for smooth signals. Each
+ * writer session ends with a footer indexing its chunks by run, vehicle and
+ * time range, linked to the previous session's footer.
+ *
+ * Layout: header | chunk, footer and run reservation records ...
+ *
+ * The file is only ever appended to. Each record is committed by writing it
+ * past the committed length in the header and then advancing that length,
+ * under an exclusive flock(), so several processes may write to the same file
+ * at once and a writer that dies keeps every chunk it committed. Readers index
+ * through the footers, or scan every record while a session has not yet
+ * written its footer or never will.
+ *
+ * Run ids are unique within a file. Opening a writer reserves its run under
+ * the lock and fails if the run was already reserved, so concurrent writers
+ * cannot mix their rows. Reservations are kept in a short chain of sorted
+ * records, merged like a binary counter, so this check reads a logarithmic
+ * number of small records rather than the index.
+ *
+ * Readers keep the index sorted by run, vehicle and start time for binary search.
+ */
+
+struct ChunkInfo
+{
+  uint32_t run;
+  uint32_t vehicle;
+  uint32_t num_rows;
+  double t_min;
+  double t_max;
+  std::vector<uint64_t> offsets; // byte offset of each column block
+  std::vector<uint64_t> sizes; // byte size of each column block
+};
+
+
+class Writer
+{
+
+public:
+
+  Writer();
+  Writer(const std::string& filename, const int& num_channels, const uint32_t& run, const int& chunk_rows = 4096);
+  ~Writer();
+
+  void open(const std::string& filename, const int& num_channels, const uint32_t& run, const int& chunk_rows = 4096);
+  void append(const uint32_t& vehicle, const double& t, const Eigen::VectorXd& data);
+  void close();
+
+  int numChannels() const { return num_channels_; }
+  uint32_t run() const { return run_; }
+
+private:
+
+  void flush(const uint32_t& vehicle);
+
+  int fd_;
+  uint32_t run_;
+  int num_channels_;
+  int chunk_rows_;
+  std::vector<ChunkInfo> chunks_; // written this session
+  std::map<uint32_t, std::vector<std::vector<double>>> buffers_; // per vehicle, per column rows awaiting a chunk
+
+};
+
+
+class Reader
+{
+
+public:
+
+  Reader();
+  Reader(const std::string& filename);
+  ~Reader();
+
+  void open(const std::string& filename);
+  void close();
+
+  const std::vector<ChunkInfo>& chunks() const { return chunks_; }
+  std::vector<int> find(const uint32_t& run, const uint32_t& vehicle, const double& t_min, const double& t_max) const;
+
+  // Encoded column bytes, directly in the mapped file
+  const uint8_t* columnData(const int& chunk, const int& column, uint64_t& size) const;
+
+  void column(const int& chunk, const int& column, std::vector<double>& values) const;
+  void read(const uint32_t& run, const uint32_t& vehicle, const double& t_min, const double& t_max, Eigen::MatrixXd& rows) const;
+
+  int numChannels() const { return num_channels_; }
+
+private:
+
+  const uint8_t* data_;
+  size_t size_;
+  int num_channels_;
+  std::vector<ChunkInfo> chunks_; // sorted by run, vehicle and t_min
+  std::vector<double> t_reach_; // running maximum of t_max within each run and vehicle
+
+};
+
+
+} // namespace trajectory_store
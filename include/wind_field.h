@@ -0,0 +1,100 @@
+#pragma once
+
+#include <mutex>
+#include <unordered_map>
+#include "common_cpp/common.h"
+
+
+namespace environment
+{
+
+
+// Spatially and temporally correlated wind field about a random global mean.
+//
+// The world is divided into square tiles whose corners are wind nodes. Each
+// node carries an independent first-order Gauss-Markov deviation, defined on a
+// lattice of time bins with noise hashed from (seed, node, bin), so the field
+// is a fixed function of position and time no matter which vehicles sample it,
+// when, or how often. Nodes are only generated for tiles that get sampled.
+//
+// A sample blends the four corners of its tile bilinearly in space and the two
+// surrounding time bins linearly in time, renormalized so the deviation keeps
+// the walk standard deviations everywhere instead of dipping between nodes.
+// The correlation between two points is the normalized dot product of their
+// corner weights: one at the same point, falling off across a tile, and zero
+// once the points share no tile corner. In time it is approximately
+// exp(-dt / wind_correlation_time).
+//
+// sample() may be called concurrently for different vehicles, e.g. from
+// per-vehicle scheduler tasks in the same stage. The field lock only covers
+// looking up and inserting nodes; new nodes are evaluated before taking it and
+// each node is advanced under its own lock, so vehicles in different tiles
+// never wait on each other.
+class WindField
+{
+
+public:
+
+  struct Node
+  {
+    int i, j; // grid indices
+    int64_t k; // time bin of v0
+    Eigen::Vector3d v0, v1; // deviations at bins k and k + 1
+    std::mutex mutex; // guards k, v0 and v1
+  };
+
+  // Per-vehicle cache of the last tile sampled, looked up again once load()
+  // has replaced the nodes it points to
+  struct Tile
+  {
+    Tile() : i(0), j(0), generation(0), corners{nullptr, nullptr, nullptr, nullptr} {}
+    int i, j;
+    uint64_t generation; // field generation the corners belong to
+    Node *corners[4];
+  };
+
+  WindField();
+  WindField(const std::string &filename, std::default_random_engine& rng);
+  ~WindField();
+
+  void load(const std::string &filename, std::default_random_engine& rng);
+  Eigen::Vector3d sample(const double &t, const Eigen::Vector3d& p, Tile& tile);
+
+  const bool& enabled() const { return enabled_; }
+  const Eigen::Vector3d& mean() const { return vw_mean_; }
+  size_t numNodes() const { return nodes_.size(); }
+
+private:
+
+  Node& node(const int &i, const int &j, const int64_t &k);
+  void advance(Node& n, const int64_t &k) const;
+  Eigen::Vector3d deviation(const int &i, const int &j, const int64_t &k) const;
+  double noise(const int &i, const int &j, const int64_t &k, const int &axis) const;
+
+  bool enabled_;
+  uint64_t seed_;
+  uint64_t generation_; // incremented by every load()
+  double tile_size_;
+  double tau_; // correlation time of each node
+  double h_; // time bin width
+  Eigen::Vector3d vw_mean_;
+  Eigen::Vector3d init_stdev_;
+  Eigen::Vector3d walk_stdev_;
+
+  // Each deviation is a truncated exponentially weighted sum of the last
+  // num_terms_ hashed noises, so it can be evaluated directly at any bin
+  int num_terms_;
+  double alpha_; // decay per time bin
+  double alpha_tail_; // weight of the noise leaving the sum
+  double scale_; // normalizes the sum to unit variance
+  double rho_; // correlation between consecutive bins
+
+  // Nodes are keyed by their packed grid indices. Elements of an unordered_map
+  // never move, so tiles may keep pointers to them until the next load().
+  std::unordered_map<uint64_t, Node> nodes_;
+  std::mutex mutex_; // guards the structure of nodes_
+
+};
+
+
+} // namespace environment
@@ -1,12 +1,22 @@
+#include <cstdio>
+#include <memory>
 #include <random>
+#include <thread>
+#include <unistd.h>
 #include <GL/glut.h>
 #include "common_cpp/common.h"
 #include "glanimator.h"
 #include "bicycle.h"
+#include "bicycle_ctrl_pid.h"
+#include "wind_field.h"
+#include "scheduler.h"
+#include "trajectory_store.h"
+#include "rasterizer.h"
 
 // OpenGL really likes global variables and functions
 glanimator::GLanimator* glanimatorPtr;
-bicycle::Bicycle* bicyclePtr;
+bicycle::Bicycled* bicyclePtr;
+scheduler::Scheduler* schedulerPtr;
 void resizeWindow(int w, int h);
 void updateSimulationAndDrawScene();
 void myKeyboardFunc(unsigned char key, int x, int y);
@@ -14,6 +24,7 @@ void mySpecialKeyFunc(int key, int x, int y);
 
 double t = 0;
 double dt = 0;
+bool autopilot = false;
 
 
 /*========================== MAIN ==========================*/
@@ -28,14 +39,114 @@ int main(int argc, char** argv)
     std::default_random_engine rng(seed);
     std::srand(seed);
 
+    // Create environment
+    environment::WindField wind("../param/simulator.yaml", rng);
+
     // Create vehicles, controllers, estimators, sensor packages
-    bicycle::Bicycle bicycle("../param/bicycle.yaml");
+    bicycle::Bicycled bicycle("../param/bicycle.yaml");
+    common::get_yaml_node("autopilot", "../param/bicycle.yaml", autopilot);
+    std::unique_ptr<bicycle_ctrl_pid::Controllerd> controller;
+    if (autopilot)
+    {
+        std::string name;
+        common::get_yaml_node("name", "../param/bicycle.yaml", name);
+        controller.reset(new bicycle_ctrl_pid::Controllerd("../param/bicycle.yaml", name));
+    }
+
+    // Trajectory log is static so its index is still written when the animator calls exit().
+    // Without a configured run id, the seed and process id keep simultaneous runs apart.
+    int run_id;
+    double wind_rate, log_rate;
+    std::string logname_trajectory;
+    common::get_yaml_node("run_id", "../param/simulator.yaml", run_id);
+    common::get_yaml_node("logname_trajectory", "../param/simulator.yaml", logname_trajectory);
+    uint32_t run = run_id < 0 ? uint32_t(seed) + uint32_t(getpid()) : uint32_t(run_id);
+    static trajectory_store::Writer trajectory_log;
+    try
+    {
+        trajectory_log.open(logname_trajectory, bicycle::NUM_STATES, run);
+    }
+    catch (const std::exception& e)
+    {
+        fprintf(stderr, "Unable to log trajectory: %s\n", e.what());
+        return 1;
+    }
+
+    // Register each component to run at its own rate
+    common::get_yaml_node("wind_update_rate", "../param/simulator.yaml", wind_rate);
+    common::get_yaml_node("log_rate", "../param/simulator.yaml", log_rate);
+    scheduler::Scheduler scheduler(dt);
+    environment::WindField::Tile wind_tile;
+    scheduler.add("wind", wind_rate, scheduler::ENVIRONMENT,
+                  [&](const double& t) { bicycle.setWind(wind.sample(t, bicycle.state().p, wind_tile)); });
+    scheduler.add("dynamics", 1.0 / dt, scheduler::DYNAMICS,
+                  [&](const double& t) { bicycle.propagate(t); });
+    if (controller)
+    {
+        double control_rate;
+        common::get_yaml_node("control_rate", "../param/bicycle.yaml", control_rate);
+        scheduler.add("control", control_rate, scheduler::CONTROL, [&](const double&)
+        {
+            controller->computeControl(bicycle.state());
+            bicycle.force() = controller->u()(bicycle::FORCE);
+            bicycle.torque() = controller->u()(bicycle::TORQUE);
+        });
+    }
+    scheduler.add("log", log_rate, scheduler::LOGGING,
+                  [&](const double& t) { trajectory_log.append(0, t, bicycle.state().toEigen()); });
+
+    // Headless runs go straight to the final time and render frames on the CPU as they are
+    // captured, a batch per core at a time, so an aborted run keeps the frames before it
+    bool headless = false;
+    common::get_yaml_node("headless", "../param/simulator.yaml", headless);
+    if (headless)
+    {
+        int frame_width, frame_height;
+        double tf, frame_rate;
+        std::string frame_prefix;
+        common::get_yaml_node("tf", "../param/simulator.yaml", tf);
+        common::get_yaml_node("frame_rate", "../param/simulator.yaml", frame_rate);
+        common::get_yaml_node("frame_width", "../param/simulator.yaml", frame_width);
+        common::get_yaml_node("frame_height", "../param/simulator.yaml", frame_height);
+        common::get_yaml_node("frame_prefix", "../param/simulator.yaml", frame_prefix);
+
+        rasterizer::Rasterizer rasterizer("../param/bicycle.yaml", frame_width, frame_height);
+        std::vector<rasterizer::Frame> frames;
+        size_t frames_written = 0;
+        size_t batch_size = std::max(1u, std::thread::hardware_concurrency());
+        auto render_frames = [&]()
+        {
+            rasterizer.renderSequence(frames, frame_prefix, frames_written);
+            frames_written += frames.size();
+            frames.clear();
+        };
+        scheduler.add("capture", frame_rate, scheduler::LOGGING, [&](const double& t)
+        {
+            frames.push_back({t, bicycle.y(), bicycle.x(), bicycle.psi(), bicycle.theta()});
+            if (frames.size() >= batch_size)
+                render_frames();
+        });
+
+        try
+        {
+            scheduler.run(tf);
+        }
+        catch (const std::exception& e)
+        {
+            fprintf(stderr, "Simulation stopped: %s\n", e.what());
+            render_frames();
+            return 1;
+        }
+        render_frames();
+        return 0;
+    }
 
     // Create animator class and give references to pointers for 
     // use in OpenGL's global functions
     glanimator::GLanimator glanimator("../param/bicycle.yaml");
     glanimatorPtr = &glanimator;
     bicyclePtr = &bicycle;
+    schedulerPtr = &scheduler;
 
     // OpenGL processes
     glutInit(&argc, argv);
@@ -64,12 +175,23 @@ void resizeWindow(int w, int h)
 
 void updateSimulationAndDrawScene()
 {
-    bicyclePtr->propagate(t);
+    try
+    {
+        schedulerPtr->run(t);
+    }
+    catch (const std::exception& e)
+    {
+        fprintf(stderr, "Simulation stopped: %s\n", e.what());
+        exit(1);
+    }
     glanimatorPtr->drawScene(t, dt, bicyclePtr->y(), bicyclePtr->x(), bicyclePtr->psi(), bicyclePtr->theta());
 
     // Ensure force/torque is only applied when key is pressed
-    bicyclePtr->force() = 0;
-    bicyclePtr->torque() = 0;
+    if (!autopilot)
+    {
+        bicyclePtr->force() = 0;
+        bicyclePtr->torque() = 0;
+    }
 }
 
 void myKeyboardFunc(unsigned char key, int x, int y)
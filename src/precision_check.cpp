@@ -0,0 +1,77 @@
+#include <cstdlib>
+#include "common_cpp/common.h"
+#include "bicycle.h"
+
+/*
+ * Accuracy regression for single precision dynamics. Runs the same vehicle in
+ * float and double under an identical deterministic input sequence and reports
+ * the divergence of their trajectories over a long horizon.
+ *
+ * USAGE:
+ *    precision_check [final time (s)] [position tolerance (m)] [heading tolerance (rad)]
+ *
+ * Returns non-zero if either tolerance is exceeded, so float is only used
+ * where this passes for the horizon of interest.
+ *
+ * The float vehicle keeps its state in float, summing increments with Kahan
+ * compensation. The compensation term is another float per state, so state
+ * plus compensation take 48 bytes, as much as a double state; inputs,
+ * derivatives, wind and parameters stay half size.
+ */
+
+
+// Smooth, non-repeating inputs that keep the vehicle turning and changing speed
+bicycle::uVector<double> inputs(const double& t, const double& max_force, const double& max_torque)
+{
+  bicycle::uVector<double> u;
+  u(bicycle::FORCE) = 0.01 * max_force * (sin(0.1 * t) + 0.5 * sin(0.37 * t));
+  u(bicycle::TORQUE) = 0.05 * max_torque * (sin(0.23 * t) + 0.5 * sin(0.71 * t));
+  return u;
+}
+
+
+int main(int argc, char** argv)
+{
+  double tf = argc > 1 ? atof(argv[1]) : 600.0;
+  double pos_tol = argc > 2 ? atof(argv[2]) : 0.1;
+  double psi_tol = argc > 3 ? atof(argv[3]) : 0.01;
+
+  double dt;
+  common::get_yaml_node("dt", "../param/simulator.yaml", dt);
+
+  bicycle::Bicyclef bicycle_f("../param/bicycle.yaml");
+  bicycle::Bicycled bicycle_d("../param/bicycle.yaml");
+
+  double max_pos_err = 0, max_psi_err = 0;
+  double t = 0;
+  int report_every = std::max(1, int(std::round(10.0 / dt)));
+  for (int i = 1; t < tf; ++i)
+  {
+    t = i * dt;
+    bicycle::uVector<double> u = inputs(t, bicycle_d.max_force(), bicycle_d.max_torque());
+    bicycle_d.force() = u(bicycle::FORCE);
+    bicycle_d.torque() = u(bicycle::TORQUE);
+    bicycle_f.force() = float(u(bicycle::FORCE));
+    bicycle_f.torque() = float(u(bicycle::TORQUE));
+    bicycle_d.propagate(t);
+    bicycle_f.propagate(t);
+
+    // Compare single precision trajectory against the double precision reference
+    bicycle::Stated x_f = bicycle_f.state().cast<double>();
+    const bicycle::Stated& x_d = bicycle_d.state();
+    double pos_err = (x_f.p - x_d.p).norm();
+    double psi_err = std::abs(common::wrapAngle(x_f.psi - x_d.psi, M_PI));
+    max_pos_err = std::max(max_pos_err, pos_err);
+    max_psi_err = std::max(max_psi_err, psi_err);
+
+    if (i % report_every == 0)
+      printf("t = %8.2f  position error = %10.3e m  heading error = %10.3e rad\n", t, pos_err, psi_err);
+  }
+
+  printf("Max position error: %.3e m (tolerance %.3e)\n", max_pos_err, pos_tol);
+  printf("Max heading error:  %.3e rad (tolerance %.3e)\n", max_psi_err, psi_tol);
+  bool safe = max_pos_err < pos_tol && max_psi_err < psi_tol;
+  printf("Single precision is %s over %.1f s\n", safe ? "SAFE" : "NOT SAFE", tf);
+
+  return safe ? 0 : 1;
+}
@@ -0,0 +1,230 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <exception>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include "car_geometry.h"
+#include "rasterizer.h"
+
+namespace rasterizer
+{
+
+
+Framebuffer::Framebuffer() : width_(0), height_(0) {}
+
+
+Framebuffer::Framebuffer(const int& width, const int& height)
+{
+  resize(width, height);
+}
+
+
+void Framebuffer::resize(const int& width, const int& height)
+{
+  width_ = width;
+  height_ = height;
+  pixels_.resize(width_ * height_);
+}
+
+
+void Framebuffer::clear(const uint32_t& color)
+{
+  for (int y = 0; y < height_; ++y)
+    fillSpan(&pixels_[y * width_], 0, width_, color);
+}
+
+
+// Even-odd scanline fill of a polygon given in pixel coordinates. Pixels are
+// covered when their centers fall inside, matching OpenGL's rasterization rule.
+void Framebuffer::fillPolygon(const Eigen::Matrix<float,2,Eigen::Dynamic>& vertices, const uint32_t& color)
+{
+  int n = vertices.cols();
+  float v_min = vertices.row(1).minCoeff();
+  float v_max = vertices.row(1).maxCoeff();
+  int y0 = std::max(0, int(std::ceil(v_min - 0.5f)));
+  int y1 = std::min(height_ - 1, int(std::floor(v_max - 0.5f)));
+
+  std::vector<float> crossings;
+  crossings.reserve(n);
+  for (int y = y0; y <= y1; ++y)
+  {
+    // Edge crossings of the scanline through the pixel centers
+    float yc = y + 0.5f;
+    crossings.clear();
+    for (int i = 0, j = n - 1; i < n; j = i++)
+    {
+      float ya = vertices(1,j), yb = vertices(1,i);
+      if ((ya <= yc) != (yb <= yc))
+        crossings.push_back(vertices(0,j) + (yc - ya) * (vertices(0,i) - vertices(0,j)) / (yb - ya));
+    }
+    std::sort(crossings.begin(), crossings.end());
+
+    for (size_t k = 0; k + 1 < crossings.size(); k += 2)
+    {
+      int x0 = std::max(0, int(std::ceil(crossings[k] - 0.5f)));
+      int x1 = std::min(width_, int(std::ceil(crossings[k+1] - 0.5f)));
+      if (x0 < x1)
+        fillSpan(&pixels_[y * width_], x0, x1, color);
+    }
+  }
+}
+
+
+void Framebuffer::writePPM(const std::string& filename) const
+{
+  std::ofstream file(filename, std::ios::binary);
+  if (!file.is_open())
+    throw std::runtime_error("rasterizer: unable to open " + filename);
+
+  file << "P6\n" << width_ << " " << height_ << "\n255\n";
+  std::vector<uint8_t> row(3 * width_);
+  for (int y = 0; y < height_; ++y)
+  {
+    for (int x = 0; x < width_; ++x)
+    {
+      uint32_t p = pixels_[y * width_ + x];
+      row[3*x] = p & 0xff;
+      row[3*x+1] = (p >> 8) & 0xff;
+      row[3*x+2] = (p >> 16) & 0xff;
+    }
+    file.write(reinterpret_cast<const char*>(row.data()), row.size());
+  }
+}
+
+
+// Fill pixels [x0, x1) of a row. Compilers vectorize the plain loop about as
+// well, the SSE2 path only guarantees it in unoptimized builds.
+void Framebuffer::fillSpan(uint32_t* row, int x0, const int& x1, const uint32_t& color)
+{
+#ifdef __SSE2__
+  const __m128i c = _mm_set1_epi32(color);
+  for (; x0 + 4 <= x1; x0 += 4)
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(row + x0), c);
+#endif
+  for (; x0 < x1; ++x0)
+    row[x0] = color;
+}
+
+
+Rasterizer::Rasterizer() : width_(0), height_(0), car_length_(car_geometry::DEFAULT_CAR_LENGTH) {}
+
+
+Rasterizer::Rasterizer(const std::string& filename, const int& width, const int& height)
+  : car_length_(car_geometry::DEFAULT_CAR_LENGTH)
+{
+  load(filename, width, height);
+}
+
+
+void Rasterizer::load(const std::string& filename, const int& width, const int& height)
+{
+  car_length_ = car_geometry::carLength(filename);
+  width_ = std::max(width, 1);
+  height_ = std::max(height, 1);
+
+  // Same view box as GLanimator::resizeWindow, centered and widened to fit the image
+  x_min_ = car_geometry::SCENE_X_MIN;
+  x_max_ = car_geometry::SCENE_X_MAX;
+  y_min_ = car_geometry::SCENE_Y_MIN;
+  y_max_ = car_geometry::SCENE_Y_MAX;
+  if ((x_max_ - x_min_) / width_ < (y_max_ - y_min_) / height_)
+  {
+    float scale = ((y_max_ - y_min_) / height_) / ((x_max_ - x_min_) / width_);
+    float center = (x_max_ + x_min_) / 2;
+    x_min_ = center - (center - x_min_) * scale;
+    x_max_ = center + (x_max_ - center) * scale;
+  }
+  else
+  {
+    float scale = ((x_max_ - x_min_) / width_) / ((y_max_ - y_min_) / height_);
+    float center = (y_max_ + y_min_) / 2;
+    y_min_ = center - (center - y_min_) * scale;
+    y_max_ = center + (y_max_ - center) * scale;
+  }
+}
+
+
+void Rasterizer::render(const Frame& frame, Framebuffer& fb) const
+{
+  if (fb.width() != width_ || fb.height() != height_)
+    fb.resize(width_, height_);
+  fb.clear(rgb(0.0, 0.0, 0.0));
+
+  car_geometry::CarPolygons car;
+  car_geometry::carPolygons(car_length_, frame.px, frame.py, frame.psi, frame.theta, car);
+
+  // Draw the car body, then the tires on top as in drawScene
+  Eigen::Matrix<float,2,Eigen::Dynamic> polygon(2, 8);
+  for (int i = 0; i < 8; ++i)
+    polygon.col(i) = toPixel(car.body.col(i));
+  fb.fillPolygon(polygon, rgb(1.0, 0.6, 0.2));
+
+  polygon.resize(2, 4);
+  for (int j = 0; j < 4; ++j)
+  {
+    for (int i = 0; i < 4; ++i)
+      polygon.col(i) = toPixel(car.tires[j].col(i));
+    fb.fillPolygon(polygon, rgb(0.6, 0.6, 0.6));
+  }
+}
+
+
+// Render frames in parallel, writing <prefix>_<first_index>.ppm, <prefix>_<first_index + 1>.ppm, ...
+// with six digit indices
+void Rasterizer::renderSequence(const std::vector<Frame>& frames, const std::string& prefix,
+                                const size_t& first_index, int num_threads) const
+{
+  if (num_threads <= 0)
+    num_threads = std::max(1u, std::thread::hardware_concurrency());
+
+  std::atomic<size_t> next(0);
+  std::exception_ptr error;
+  std::mutex error_mutex;
+  auto worker = [&]()
+  {
+    Framebuffer fb(width_, height_);
+    std::vector<char> filename(prefix.size() + 16);
+    for (size_t i = next++; i < frames.size(); i = next++)
+    {
+      try
+      {
+        render(frames[i], fb);
+        snprintf(filename.data(), filename.size(), "%s_%06zu.ppm", prefix.c_str(), first_index + i);
+        fb.writePPM(filename.data());
+      }
+      catch (...)
+      {
+        std::lock_guard<std::mutex> lock(error_mutex);
+        if (!error) error = std::current_exception();
+        next = frames.size();
+      }
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (int k = 0; k < num_threads; ++k)
+    threads.push_back(std::thread(worker));
+  for (std::thread& thread : threads)
+    thread.join();
+
+  if (error)
+    std::rethrow_exception(error);
+}
+
+
+// Drawing frame to pixel coordinates, with image rows running top to bottom
+Eigen::Vector2f Rasterizer::toPixel(const Eigen::Vector3f& v) const
+{
+  return Eigen::Vector2f((v(0) - x_min_) / (x_max_ - x_min_) * width_,
+                         (y_max_ - v(1)) / (y_max_ - y_min_) * height_);
+}
+
+
+} // namespace rasterizer
@@ -0,0 +1,47 @@
+#include <cstdlib>
+#include <limits>
+#include "common_cpp/common.h"
+#include "bicycle.h"
+#include "rasterizer.h"
+#include "trajectory_store.h"
+
+/*
+ * Render a logged vehicle trajectory to a PPM image sequence without a display.
+ *
+ * USAGE:
+ *    render_replay <trajectory file> <run id> <vehicle id> <output prefix> [frame rate (Hz)] [width] [height]
+ */
+
+
+int main(int argc, char** argv)
+{
+  if (argc < 5)
+  {
+    printf("Usage: %s <trajectory file> <run id> <vehicle id> <output prefix> [frame rate (Hz)] [width] [height]\n", argv[0]);
+    return 1;
+  }
+  double frame_rate = argc > 5 ? atof(argv[5]) : 10.0;
+  int width = argc > 6 ? atoi(argv[6]) : 256;
+  int height = argc > 7 ? atoi(argv[7]) : width;
+
+  // Columns are time followed by the vehicle state
+  Eigen::MatrixXd rows;
+  trajectory_store::Reader reader(argv[1]);
+  reader.read(atoi(argv[2]), atoi(argv[3]), -std::numeric_limits<double>::max(), std::numeric_limits<double>::max(), rows);
+
+  // Keep one row per frame period, in the drawing frame used by the animator (x east, y north)
+  std::vector<rasterizer::Frame> frames;
+  double t_next = -std::numeric_limits<double>::max();
+  for (int i = 0; i < rows.rows(); ++i)
+  {
+    if (rows(i,0) < t_next) continue;
+    t_next = rows(i,0) + 1.0 / frame_rate;
+    frames.push_back({rows(i,0), rows(i,1+bicycle::PY), rows(i,1+bicycle::PX), rows(i,1+bicycle::PSI), rows(i,1+bicycle::THETA)});
+  }
+
+  rasterizer::Rasterizer rasterizer("../param/bicycle.yaml", width, height);
+  rasterizer.renderSequence(frames, argv[4]);
+  printf("Wrote %zu frames to %s_*.ppm\n", frames.size(), argv[4]);
+
+  return 0;
+}
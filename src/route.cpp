@@ -0,0 +1,315 @@
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include "route.h"
+
+namespace route
+{
+
+
+static const int MAX_CELLS = 1 << 20;
+
+
+Route::Route()
+  : closed_(false), initialized_(false), search_distance_(50.0), relocalize_distance_(20.0),
+    segment_(0), s_nearest_(0), cross_track_error_(0), heading_(0), moved_(0)
+{
+  nearest_.setZero();
+  p_prev_.setZero();
+}
+
+
+Route::Route(const std::string& filename)
+  : closed_(false), initialized_(false), search_distance_(50.0), relocalize_distance_(20.0),
+    segment_(0), s_nearest_(0), cross_track_error_(0), heading_(0), moved_(0)
+{
+  nearest_.setZero();
+  p_prev_.setZero();
+  load(filename);
+}
+
+
+Route::~Route() {}
+
+
+void Route::load(const std::string& filename)
+{
+  std::ifstream file(filename, std::ios::binary);
+  uint64_t num_vertices = 0;
+  file.read(reinterpret_cast<char*>(&num_vertices), sizeof(num_vertices));
+  if (!file || num_vertices < 2)
+    throw std::runtime_error("route: unable to read vertices from " + filename);
+
+  Eigen::Matrix<double,2,Eigen::Dynamic> vertices(2, num_vertices);
+  file.read(reinterpret_cast<char*>(vertices.data()), 2 * num_vertices * sizeof(double));
+  if (!file)
+    throw std::runtime_error("route: " + filename + " is shorter than its vertex count");
+
+  // A repeated first vertex marks a closed loop
+  bool closed = num_vertices > 2 && vertices.col(0) == vertices.col(num_vertices-1);
+  if (closed)
+    set(vertices.leftCols(num_vertices-1), true);
+  else
+    set(vertices, false);
+}
+
+
+void Route::set(const Eigen::Matrix<double,2,Eigen::Dynamic>& vertices, const bool& closed)
+{
+  if (vertices.cols() < 2)
+    throw std::runtime_error("route: a route needs at least two vertices");
+  if (!vertices.allFinite())
+    throw std::runtime_error("route: vertices must be finite");
+
+  vertices_ = vertices;
+  closed_ = closed && vertices_.cols() > 2;
+  initialized_ = false;
+
+  // Cumulative arc length at the start of each segment
+  int n = numSegments();
+  s_.resize(n + 1);
+  s_[0] = 0;
+  for (int i = 0; i < n; ++i)
+    s_[i+1] = s_[i] + (vertices_.col(next(i)) - vertices_.col(i)).norm();
+
+  buildIndex();
+}
+
+
+void Route::setSearch(const double& search_distance, const double& relocalize_distance)
+{
+  search_distance_ = search_distance;
+  relocalize_distance_ = relocalize_distance;
+}
+
+
+// Find the nearest point on the route, searching outward from the last match
+void Route::update(const Eigen::Vector2d& p)
+{
+  if (empty())
+    throw std::runtime_error("route: update called before a route was set");
+  if (!initialized_)
+  {
+    relocalize(p);
+    return;
+  }
+
+  int n = numSegments();
+  double frac, best_frac;
+  double best_d = project(segment_, p, best_frac);
+  int best_i = segment_;
+
+  // Search ahead until well past the best match or the search window is used up
+  int i = segment_;
+  double traveled = 0, best_traveled = 0;
+  for (int k = 1; k < n; ++k)
+  {
+    traveled += s_[i+1] - s_[i];
+    if (!closed_ && i + 1 >= n) break;
+    i = (i + 1) % n;
+    if (traveled > search_distance_ || traveled - best_traveled > 2.0 * best_d + (s_[i+1] - s_[i])) break;
+    double d = project(i, p, frac);
+    if (d < best_d)
+    {
+      best_d = d;
+      best_frac = frac;
+      best_i = i;
+      best_traveled = traveled;
+    }
+  }
+
+  // Allow a short step back, e.g. when reversing
+  i = segment_;
+  traveled = 0;
+  for (int k = 1; k < n; ++k)
+  {
+    if (!closed_ && i == 0) break;
+    i = (i + n - 1) % n;
+    traveled += s_[i+1] - s_[i];
+    if (traveled > 0.25 * search_distance_ || traveled > 2.0 * best_d + (s_[i+1] - s_[i])) break;
+    double d = project(i, p, frac);
+    if (d < best_d)
+    {
+      best_d = d;
+      best_frac = frac;
+      best_i = i;
+    }
+  }
+
+  // Far from the route, the window result is within twice the distance
+  // traveled since the last global search of the true nearest point, so
+  // only search globally again once that reaches relocalize_distance_
+  moved_ += (p - p_prev_).norm();
+  p_prev_ = p;
+  if (best_d > relocalize_distance_ && moved_ > relocalize_distance_)
+    relocalize(p);
+  else
+    match(best_i, best_frac, p);
+}
+
+
+// Point on the route a given arc length ahead of the nearest point
+Eigen::Vector2d Route::lookahead(const double& distance) const
+{
+  if (empty())
+    throw std::runtime_error("route: lookahead called before a route was set");
+
+  int n = numSegments();
+  int i = segment_;
+  double remaining = s_nearest_ - s_[i] + distance;
+  for (int k = 0; k <= n; ++k)
+  {
+    double len = s_[i+1] - s_[i];
+    if (remaining <= len)
+      return vertices_.col(i) + (len > 0 ? remaining / len : 0.0) * (vertices_.col(next(i)) - vertices_.col(i));
+    if (!closed_ && i == n - 1)
+      break;
+    remaining -= len;
+    i = (i + 1) % n;
+  }
+  return vertices_.col(next(i));
+}
+
+
+// Distance from p to segment i and the fraction along it of the closest point
+double Route::project(const int& i, const Eigen::Vector2d& p, double& frac) const
+{
+  Eigen::Vector2d a = vertices_.col(i);
+  Eigen::Vector2d ab = vertices_.col(next(i)) - a;
+  double len2 = ab.squaredNorm();
+  frac = len2 > 0 ? std::min(1.0, std::max(0.0, (p - a).dot(ab) / len2)) : 0.0;
+  return (a + frac * ab - p).norm();
+}
+
+
+void Route::match(const int& i, const double& frac, const Eigen::Vector2d& p)
+{
+  Eigen::Vector2d a = vertices_.col(i);
+  Eigen::Vector2d ab = vertices_.col(next(i)) - a;
+  double len = s_[i+1] - s_[i];
+
+  initialized_ = true;
+  segment_ = i;
+  nearest_ = a + frac * ab;
+  s_nearest_ = s_[i] + frac * len;
+  heading_ = atan2(ab(1), ab(0));
+  cross_track_error_ = len > 0 ? (ab(0) * (p(1) - a(1)) - ab(1) * (p(0) - a(0))) / len : 0.0; // positive right of route
+}
+
+
+// Global nearest segment search over grid rings of increasing size
+void Route::relocalize(const Eigen::Vector2d& p)
+{
+  int cx = std::floor((p(0) - origin_(0)) / cell_size_);
+  int cy = std::floor((p(1) - origin_(1)) / cell_size_);
+  int r_max = std::max(std::max(std::abs(cx), std::abs(cx - cells_x_)), std::max(std::abs(cy), std::abs(cy - cells_y_)));
+
+  double frac, best_frac = 0;
+  double best_d = std::numeric_limits<double>::max();
+  int best_i = 0;
+  for (int r = 0; r <= r_max; ++r)
+  {
+    // Every cell in ring r is at least (r - 1) cells away from p
+    if ((r - 1) * cell_size_ > best_d) break;
+
+    for (int ix = std::max(cx - r, 0); ix <= std::min(cx + r, cells_x_ - 1); ++ix)
+    {
+      for (int iy = std::max(cy - r, 0); iy <= std::min(cy + r, cells_y_ - 1); ++iy)
+      {
+        if (std::abs(ix - cx) != r && std::abs(iy - cy) != r)
+        {
+          iy = cy + r - 1; // skip the interior already searched
+          continue;
+        }
+        auto range = std::equal_range(cells_.begin(), cells_.end(), std::make_pair(cellKey(ix, iy), 0),
+                                      [](const std::pair<uint64_t, int>& a, const std::pair<uint64_t, int>& b)
+                                      { return a.first < b.first; });
+        for (auto it = range.first; it != range.second; ++it)
+        {
+          double d = project(it->second, p, frac);
+          if (d < best_d)
+          {
+            best_d = d;
+            best_frac = frac;
+            best_i = it->second;
+          }
+        }
+      }
+    }
+  }
+  p_prev_ = p;
+  moved_ = 0;
+  match(best_i, best_frac, p);
+}
+
+
+// Bucket segments into a uniform grid a few average segment lengths wide,
+// coarsened if needed to keep at most MAX_CELLS cells along each axis
+void Route::buildIndex()
+{
+  int n = numSegments();
+  Eigen::Vector2d max = vertices_.rowwise().maxCoeff();
+  origin_ = vertices_.rowwise().minCoeff();
+  cell_size_ = std::max(4.0 * s_.back() / n, 1e-3);
+  cell_size_ = std::max(cell_size_, (max - origin_).maxCoeff() / (MAX_CELLS - 1));
+  cells_x_ = int((max(0) - origin_(0)) / cell_size_) + 1;
+  cells_y_ = int((max(1) - origin_(1)) / cell_size_) + 1;
+
+  // Walk the cells each segment crosses, so a long leg costs its length in
+  // cells rather than the area of its bounding box
+  cells_.clear();
+  for (int i = 0; i < n; ++i)
+  {
+    Eigen::Vector2d a = (vertices_.col(i) - origin_) / cell_size_;
+    Eigen::Vector2d b = (vertices_.col(next(i)) - origin_) / cell_size_;
+    int ix = std::min(int(a(0)), cells_x_ - 1);
+    int iy = std::min(int(a(1)), cells_y_ - 1);
+    int ix_end = std::min(int(b(0)), cells_x_ - 1);
+    int iy_end = std::min(int(b(1)), cells_y_ - 1);
+    int step_x = ix_end > ix ? 1 : -1;
+    int step_y = iy_end > iy ? 1 : -1;
+
+    // Parameter along the segment at the next x and y cell boundaries
+    double inf = std::numeric_limits<double>::infinity();
+    double dt_x = a(0) != b(0) ? 1.0 / std::abs(b(0) - a(0)) : inf;
+    double dt_y = a(1) != b(1) ? 1.0 / std::abs(b(1) - a(1)) : inf;
+    double t_x = (step_x > 0 ? ix + 1 - a(0) : a(0) - ix) * dt_x;
+    double t_y = (step_y > 0 ? iy + 1 - a(1) : a(1) - iy) * dt_y;
+
+    cells_.push_back(std::make_pair(cellKey(ix, iy), i));
+    while (ix != ix_end || iy != iy_end)
+    {
+      bool move_x = iy == iy_end || (ix != ix_end && t_x <= t_y);
+      bool move_y = ix == ix_end || (iy != iy_end && t_y <= t_x);
+      if (move_x && move_y)
+      {
+        // Through a corner, also keep both cells touching it
+        cells_.push_back(std::make_pair(cellKey(ix + step_x, iy), i));
+        cells_.push_back(std::make_pair(cellKey(ix, iy + step_y), i));
+      }
+      if (move_x)
+      {
+        ix += step_x;
+        t_x += dt_x;
+      }
+      if (move_y)
+      {
+        iy += step_y;
+        t_y += dt_y;
+      }
+      cells_.push_back(std::make_pair(cellKey(ix, iy), i));
+    }
+  }
+  std::sort(cells_.begin(), cells_.end());
+}
+
+
+uint64_t Route::cellKey(const int& ix, const int& iy) const
+{
+  return uint64_t(ix) * cells_y_ + iy;
+}
+
+
+} // namespace route
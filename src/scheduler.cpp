@@ -0,0 +1,122 @@
+#include <algorithm>
+#include <cmath>
+#include <exception>
+#include <sstream>
+#include <stdexcept>
+#include "scheduler.h"
+
+namespace scheduler
+{
+
+
+Scheduler::Scheduler() : dt_(0), tick_(0) {}
+
+
+Scheduler::Scheduler(const double &dt)
+{
+  init(dt);
+}
+
+
+Scheduler::~Scheduler() {}
+
+
+void Scheduler::init(const double &dt)
+{
+  dt_ = dt;
+  tick_ = 0;
+  tasks_.clear();
+  events_.clear();
+}
+
+
+// Register a task that wakes at the given rate (Hz), offset by phase (s).
+// The period must be a whole number of base time steps.
+int Scheduler::add(const std::string& name, const double& rate, const int& stage,
+                   std::function<void(const double&)> callback, const double& phase)
+{
+  if (!(rate > 0) || std::isinf(rate))
+    throw std::runtime_error("scheduler: task " + name + " needs a positive, finite rate");
+  if (!(phase >= 0) || std::isinf(phase))
+    throw std::runtime_error("scheduler: task " + name + " needs a non-negative, finite phase");
+
+  double ticks = 1.0 / (rate * dt_);
+  uint64_t period = std::max(1.0, std::round(ticks));
+  if (std::abs(ticks - period) > 1e-6 * ticks)
+  {
+    std::stringstream ss;
+    ss << "scheduler: task " << name << " rate " << rate << " Hz is not a whole number of "
+       << dt_ << " s steps, nearest achievable rate is " << 1.0 / (period * dt_) << " Hz";
+    throw std::runtime_error(ss.str());
+  }
+
+  Task task;
+  task.name = name;
+  task.period = period;
+  task.stage = stage;
+  task.callback = callback;
+  tasks_.push_back(task);
+
+  Event event;
+  event.tick = tick_ + uint64_t(std::round(phase / dt_));
+  event.stage = stage;
+  event.id = tasks_.size() - 1;
+  events_.push_back(event);
+  std::push_heap(events_.begin(), events_.end());
+
+  return event.id;
+}
+
+
+// Run every task due at or before time t, in (tick, stage, id) order
+void Scheduler::run(const double &t)
+{
+  uint64_t tick_final = uint64_t(std::floor(t / dt_ + 1e-6));
+  while (!events_.empty() && events_.front().tick <= tick_final)
+  {
+    // Pull all events sharing the earliest tick and stage
+    batch_.clear();
+    const uint64_t tick = events_.front().tick;
+    const int stage = events_.front().stage;
+    while (!events_.empty() && events_.front().tick == tick && events_.front().stage == stage)
+    {
+      std::pop_heap(events_.begin(), events_.end());
+      batch_.push_back(events_.back());
+      events_.pop_back();
+    }
+    tick_ = tick;
+
+    // Tasks within a stage are independent, so they can run concurrently.
+    // Exceptions cannot leave the parallel loop, so the first is kept and
+    // rethrown once every task in the batch is rescheduled.
+    const double t_event = tick * dt_;
+    std::exception_ptr error;
+    #pragma omp parallel for if(batch_.size() > 1)
+    for (int i = 0; i < int(batch_.size()); ++i)
+    {
+      try
+      {
+        tasks_[batch_[i].id].callback(t_event);
+      }
+      catch (...)
+      {
+        #pragma omp critical(scheduler_error)
+        if (!error) error = std::current_exception();
+      }
+    }
+
+    // Schedule next wake-ups
+    for (Event& event : batch_)
+    {
+      event.tick += tasks_[event.id].period;
+      events_.push_back(event);
+      std::push_heap(events_.begin(), events_.end());
+    }
+    if (error)
+      std::rethrow_exception(error);
+  }
+  tick_ = std::max(tick_, tick_final);
+}
+
+
+} // namespace scheduler
@@ -0,0 +1,898 @@
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "trajectory_store.h"
+
+namespace trajectory_store
+{
+
+
+namespace
+{
+
+
+const char MAGIC[8] = {'C', 'A', 'R', 'S', 'I', 'M', 'T', 'S'};
+const uint32_t VERSION = 3;
+const uint32_t CHUNK_TAG = 0x4b4e4843; // "CHNK"
+const uint32_t FOOTER_TAG = 0x544f4f46; // "FOOT"
+const uint32_t RUNS_TAG = 0x534e5552; // "RUNS"
+
+// Header: magic | version | channel count | file state
+struct FileState
+{
+  uint64_t end; // committed length
+  uint64_t last_footer;
+  uint64_t last_runs; // latest run reservation
+  uint64_t num_chunks; // chunk records committed
+};
+const uint64_t STATE_OFFSET = sizeof(MAGIC) + 2 * sizeof(uint32_t);
+const uint64_t HEADER_SIZE = STATE_OFFSET + sizeof(FileState);
+
+// Run reservations: prev record | count | sorted run ids
+struct RunsRecord
+{
+  uint64_t offset;
+  uint64_t prev;
+  std::vector<uint32_t> runs;
+};
+
+// Every record starts with its tag and body size
+const uint64_t RECORD_HEADER_SIZE = 2 * sizeof(uint32_t) + sizeof(uint64_t);
+
+
+template<typename T>
+void put(std::vector<uint8_t>& out, const T& value)
+{
+  const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+  out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+
+template<typename T>
+T get(const uint8_t*& in)
+{
+  T value;
+  memcpy(&value, in, sizeof(T));
+  in += sizeof(T);
+  return value;
+}
+
+
+uint64_t toBits(const double& value)
+{
+  uint64_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+
+double fromBits(const uint64_t& bits)
+{
+  double value;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+
+class BitWriter
+{
+public:
+  BitWriter(std::vector<uint8_t>& out) : out_(out), byte_(0), count_(0) {}
+
+  // Write the lowest num_bits of value, most significant bit first
+  void write(const uint64_t& value, int num_bits)
+  {
+    while (num_bits > 0)
+    {
+      int take = std::min(8 - count_, num_bits);
+      byte_ = (byte_ << take) | ((value >> (num_bits - take)) & ((1u << take) - 1));
+      count_ += take;
+      num_bits -= take;
+      if (count_ == 8)
+      {
+        out_.push_back(byte_);
+        byte_ = 0;
+        count_ = 0;
+      }
+    }
+  }
+
+  void finish()
+  {
+    if (count_ > 0)
+      out_.push_back(byte_ << (8 - count_));
+    byte_ = 0;
+    count_ = 0;
+  }
+
+private:
+  std::vector<uint8_t>& out_;
+  uint32_t byte_;
+  int count_;
+};
+
+
+class BitReader
+{
+public:
+  BitReader(const uint8_t* in) : in_(in), bit_(0) {}
+
+  uint64_t read(int num_bits)
+  {
+    uint64_t value = 0;
+    while (num_bits > 0)
+    {
+      int offset = bit_ & 7;
+      int take = std::min(8 - offset, num_bits);
+      uint32_t bits = (in_[bit_ >> 3] >> (8 - offset - take)) & ((1u << take) - 1);
+      value = (value << take) | bits;
+      bit_ += take;
+      num_bits -= take;
+    }
+    return value;
+  }
+
+private:
+  const uint8_t* in_;
+  uint64_t bit_;
+};
+
+
+void putVarint(std::vector<uint8_t>& out, uint64_t value)
+{
+  while (value >= 0x80)
+  {
+    out.push_back(uint8_t(value) | 0x80);
+    value >>= 7;
+  }
+  out.push_back(uint8_t(value));
+}
+
+
+uint64_t getVarint(const uint8_t*& in)
+{
+  uint64_t value = 0;
+  for (int shift = 0; ; shift += 7)
+  {
+    uint8_t byte = *in++;
+    value |= uint64_t(byte & 0x7f) << shift;
+    if (!(byte & 0x80))
+      return value;
+  }
+}
+
+
+uint64_t zigzag(const int64_t& value) { return (uint64_t(value) << 1) ^ uint64_t(value >> 63); }
+int64_t unzigzag(const uint64_t& value) { return int64_t(value >> 1) ^ -int64_t(value & 1); }
+
+
+// Delta-of-delta on the bit patterns. Evenly spaced times within one binade
+// have constant deltas, so most rows cost a single byte.
+void encodeTime(const std::vector<double>& values, std::vector<uint8_t>& out)
+{
+  int64_t prev = 0, prev_delta = 0;
+  for (size_t i = 0; i < values.size(); ++i)
+  {
+    int64_t bits = int64_t(toBits(values[i]));
+    int64_t delta = int64_t(uint64_t(bits) - uint64_t(prev));
+    if (i == 0)
+      put(out, bits);
+    else
+      putVarint(out, zigzag(int64_t(uint64_t(delta) - uint64_t(prev_delta))));
+    prev = bits;
+    prev_delta = i == 0 ? 0 : delta;
+  }
+}
+
+
+void decodeTime(const uint8_t* in, const uint32_t& num_rows, double* values)
+{
+  int64_t prev = 0, prev_delta = 0;
+  for (uint32_t i = 0; i < num_rows; ++i)
+  {
+    int64_t bits;
+    if (i == 0)
+    {
+      bits = get<int64_t>(in);
+    }
+    else
+    {
+      prev_delta = int64_t(uint64_t(prev_delta) + uint64_t(unzigzag(getVarint(in))));
+      bits = int64_t(uint64_t(prev) + uint64_t(prev_delta));
+    }
+    values[i] = fromBits(uint64_t(bits));
+    prev = bits;
+  }
+}
+
+
+// XOR float encoding: each value is XORed with the previous one and only the
+// meaningful bits between the leading and trailing zeros are stored, reusing
+// the previous bit window when it still fits.
+void encodeXor(const std::vector<double>& values, std::vector<uint8_t>& out)
+{
+  BitWriter writer(out);
+  uint64_t prev = 0;
+  int prev_lead = -1, prev_trail = 0;
+  for (size_t i = 0; i < values.size(); ++i)
+  {
+    uint64_t bits = toBits(values[i]);
+    if (i == 0)
+    {
+      writer.write(bits, 64);
+      prev = bits;
+      continue;
+    }
+
+    uint64_t x = bits ^ prev;
+    prev = bits;
+    if (x == 0)
+    {
+      writer.write(0, 1);
+      continue;
+    }
+
+    int lead = std::min(__builtin_clzll(x), 31);
+    int trail = __builtin_ctzll(x);
+    if (prev_lead >= 0 && lead >= prev_lead && trail >= prev_trail)
+    {
+      writer.write(2, 2); // '10': reuse window
+      writer.write(x >> prev_trail, 64 - prev_lead - prev_trail);
+    }
+    else
+    {
+      int length = 64 - lead - trail;
+      writer.write(3, 2); // '11': new window
+      writer.write(lead, 5);
+      writer.write(length - 1, 6);
+      writer.write(x >> trail, length);
+      prev_lead = lead;
+      prev_trail = trail;
+    }
+  }
+  writer.finish();
+}
+
+
+void decodeXor(const uint8_t* in, const uint32_t& num_rows, double* values)
+{
+  BitReader reader(in);
+  uint64_t prev = 0;
+  int lead = 0, trail = 0;
+  for (uint32_t i = 0; i < num_rows; ++i)
+  {
+    if (i == 0)
+    {
+      prev = reader.read(64);
+    }
+    else if (reader.read(1) == 1)
+    {
+      if (reader.read(1) == 1)
+      {
+        lead = reader.read(5);
+        trail = 64 - lead - int(reader.read(6) + 1);
+      }
+      prev ^= reader.read(64 - lead - trail) << trail;
+    }
+    values[i] = fromBits(prev);
+  }
+}
+
+
+
+// Chunk description: run | vehicle | rows | t_min | t_max | column sizes
+uint64_t chunkHeaderSize(const int& num_channels)
+{
+  return 4 * sizeof(uint32_t) + 2 * sizeof(double) + (num_channels + 1) * sizeof(uint64_t);
+}
+
+
+void encodeChunkHeader(const ChunkInfo& chunk, std::vector<uint8_t>& out)
+{
+  put(out, chunk.run);
+  put(out, chunk.vehicle);
+  put(out, chunk.num_rows);
+  put(out, uint32_t(0));
+  put(out, chunk.t_min);
+  put(out, chunk.t_max);
+  for (const uint64_t& size : chunk.sizes)
+    put(out, size);
+}
+
+
+// Parse a chunk description for the record at the given offset, returning
+// false if its column blocks would extend past the committed end of the file
+bool decodeChunkHeader(const uint8_t* in, const uint64_t& record, const uint64_t& end,
+                       const int& num_channels, ChunkInfo& chunk)
+{
+  chunk.run = get<uint32_t>(in);
+  chunk.vehicle = get<uint32_t>(in);
+  chunk.num_rows = get<uint32_t>(in);
+  get<uint32_t>(in);
+  chunk.t_min = get<double>(in);
+  chunk.t_max = get<double>(in);
+
+  uint64_t offset = record + RECORD_HEADER_SIZE + chunkHeaderSize(num_channels);
+  if (offset > end)
+    return false;
+  chunk.offsets.resize(num_channels + 1);
+  chunk.sizes.resize(num_channels + 1);
+  for (int j = 0; j <= num_channels; ++j)
+  {
+    chunk.sizes[j] = get<uint64_t>(in);
+    if (chunk.sizes[j] > end - offset)
+      return false;
+    chunk.offsets[j] = offset;
+    offset += chunk.sizes[j];
+  }
+  return true;
+}
+
+
+uint64_t chunkRecordEnd(const ChunkInfo& chunk)
+{
+  return chunk.offsets.back() + chunk.sizes.back();
+}
+
+
+// Footer: previous footer | chunk count | record offset and description of each chunk
+void encodeFooter(const std::vector<ChunkInfo>& chunks, const int& num_channels, std::vector<uint8_t>& out)
+{
+  put(out, FOOTER_TAG);
+  put(out, uint32_t(0));
+  put(out, uint64_t(0)); // body size
+  put(out, uint64_t(0)); // previous footer, filled in on commit
+  put(out, uint64_t(chunks.size()));
+  for (const ChunkInfo& chunk : chunks)
+  {
+    put(out, chunk.offsets[0] - RECORD_HEADER_SIZE - chunkHeaderSize(num_channels));
+    encodeChunkHeader(chunk, out);
+  }
+  uint64_t body_size = out.size() - RECORD_HEADER_SIZE;
+  memcpy(out.data() + 2 * sizeof(uint32_t), &body_size, sizeof(body_size));
+}
+
+
+// Index the file through its chain of footers, one per writer session.
+// Fails if any footer is out of bounds.
+bool indexFooters(const uint8_t* data, const FileState& state, const int& num_channels, std::vector<ChunkInfo>& chunks)
+{
+  const uint64_t end = state.end;
+  const uint64_t entry_size = sizeof(uint64_t) + chunkHeaderSize(num_channels);
+  uint64_t footer = state.last_footer;
+  while (footer != 0)
+  {
+    if (footer < HEADER_SIZE || footer > end - RECORD_HEADER_SIZE)
+      return false;
+    const uint8_t* in = data + footer;
+    uint32_t tag = get<uint32_t>(in);
+    get<uint32_t>(in);
+    uint64_t body_size = get<uint64_t>(in);
+    if (tag != FOOTER_TAG || body_size > end - footer - RECORD_HEADER_SIZE || body_size < 2 * sizeof(uint64_t))
+      return false;
+
+    uint64_t prev = get<uint64_t>(in);
+    uint64_t num_chunks = get<uint64_t>(in);
+    if (num_chunks > (body_size - 2 * sizeof(uint64_t)) / entry_size || (prev != 0 && prev >= footer))
+      return false;
+    for (uint64_t i = 0; i < num_chunks; ++i)
+    {
+      uint64_t record = get<uint64_t>(in);
+      ChunkInfo chunk;
+      if (record < HEADER_SIZE || record > end || !decodeChunkHeader(in, record, end, num_channels, chunk))
+        return false;
+      in += chunkHeaderSize(num_channels);
+      chunks.push_back(chunk);
+    }
+    footer = prev;
+  }
+  return true;
+}
+
+
+// Index the file by walking every record from the header to the committed end
+void scanRecords(const uint8_t* data, const uint64_t& end, const int& num_channels, std::vector<ChunkInfo>& chunks)
+{
+  uint64_t record = HEADER_SIZE;
+  while (record < end)
+  {
+    if (end - record < RECORD_HEADER_SIZE)
+      throw std::runtime_error("trajectory_store: truncated record");
+    const uint8_t* in = data + record;
+    uint32_t tag = get<uint32_t>(in);
+    get<uint32_t>(in);
+    uint64_t body_size = get<uint64_t>(in);
+    if (body_size > end - record - RECORD_HEADER_SIZE)
+      throw std::runtime_error("trajectory_store: truncated record");
+
+    if (tag == CHUNK_TAG)
+    {
+      ChunkInfo chunk;
+      if (body_size < chunkHeaderSize(num_channels) || !decodeChunkHeader(in, record, end, num_channels, chunk) ||
+          chunkRecordEnd(chunk) != record + RECORD_HEADER_SIZE + body_size)
+        throw std::runtime_error("trajectory_store: corrupt chunk record");
+      chunks.push_back(chunk);
+    }
+    else if (tag != FOOTER_TAG && tag != RUNS_TAG)
+    {
+      throw std::runtime_error("trajectory_store: unknown record");
+    }
+    record += RECORD_HEADER_SIZE + body_size;
+  }
+}
+
+
+// Parse the chunk index from a file image, sorted by run, vehicle and start
+// time. If the footers do not list every committed chunk, because a writer is
+// still running or was killed before its footer, every record is scanned instead.
+void loadIndex(const uint8_t* data, const size_t& size, int& num_channels, std::vector<ChunkInfo>& chunks)
+{
+  if (size < HEADER_SIZE || memcmp(data, MAGIC, sizeof(MAGIC)))
+    throw std::runtime_error("trajectory_store: not a trajectory file");
+
+  const uint8_t* in = data + sizeof(MAGIC);
+  if (get<uint32_t>(in) != VERSION)
+    throw std::runtime_error("trajectory_store: unsupported file version");
+  num_channels = get<uint32_t>(in);
+  FileState state = get<FileState>(in);
+  if (num_channels < 0 || num_channels > 1 << 16 || state.end < HEADER_SIZE || state.end > size)
+    throw std::runtime_error("trajectory_store: corrupt header");
+
+  chunks.clear();
+  if (!indexFooters(data, state, num_channels, chunks) || chunks.size() != state.num_chunks)
+  {
+    chunks.clear();
+    scanRecords(data, state.end, num_channels, chunks);
+  }
+  std::sort(chunks.begin(), chunks.end(), [](const ChunkInfo& a, const ChunkInfo& b)
+  {
+    if (a.run != b.run) return a.run < b.run;
+    if (a.vehicle != b.vehicle) return a.vehicle < b.vehicle;
+    if (a.t_min != b.t_min) return a.t_min < b.t_min;
+    return a.offsets[0] < b.offsets[0];
+  });
+}
+
+
+void readAll(const int& fd, uint8_t* data, size_t size, uint64_t offset)
+{
+  while (size > 0)
+  {
+    ssize_t n = pread(fd, data, size, offset);
+    if (n <= 0)
+      throw std::runtime_error("trajectory_store: read failed");
+    data += n;
+    size -= n;
+    offset += n;
+  }
+}
+
+
+void writeAll(const int& fd, const uint8_t* data, size_t size, uint64_t offset)
+{
+  while (size > 0)
+  {
+    ssize_t n = pwrite(fd, data, size, offset);
+    if (n <= 0)
+      throw std::runtime_error("trajectory_store: write failed");
+    data += n;
+    size -= n;
+    offset += n;
+  }
+}
+
+
+FileState readState(const int& fd)
+{
+  FileState state;
+  readAll(fd, reinterpret_cast<uint8_t*>(&state), sizeof(state), STATE_OFFSET);
+  return state;
+}
+
+
+// Exclusive advisory lock on the whole file, held while committing a record
+class FileLock
+{
+public:
+  FileLock(const int& fd) : fd_(fd)
+  {
+    if (flock(fd_, LOCK_EX) != 0)
+      throw std::runtime_error("trajectory_store: unable to lock file");
+  }
+  ~FileLock() { flock(fd_, LOCK_UN); }
+private:
+  int fd_;
+};
+
+
+// Append a record at the committed end of the file and then write the new
+// state with the end advanced. The caller holds the file lock, so concurrent
+// writers never interleave, and a writer killed mid-record leaves bytes the
+// next commit simply overwrites. Returns the record's offset.
+uint64_t commit(const int& fd, const std::vector<uint8_t>& record, FileState& state)
+{
+  uint64_t offset = state.end;
+  writeAll(fd, record.data(), record.size(), offset);
+  state.end = offset + record.size();
+  writeAll(fd, reinterpret_cast<const uint8_t*>(&state), sizeof(state), STATE_OFFSET);
+  return offset;
+}
+
+
+// Read the run reservation chain, newest record first
+void readRuns(const int& fd, const FileState& state, std::vector<RunsRecord>& records)
+{
+  uint64_t record = state.last_runs;
+  while (record != 0)
+  {
+    uint8_t head[RECORD_HEADER_SIZE + 2 * sizeof(uint64_t)];
+    if (record < HEADER_SIZE || record > state.end - sizeof(head))
+      throw std::runtime_error("trajectory_store: corrupt run reservation");
+    readAll(fd, head, sizeof(head), record);
+    const uint8_t* in = head;
+    uint32_t tag = get<uint32_t>(in);
+    get<uint32_t>(in);
+    uint64_t body_size = get<uint64_t>(in);
+    uint64_t prev = get<uint64_t>(in);
+    uint64_t count = get<uint64_t>(in);
+    if (tag != RUNS_TAG || count > (state.end - record - sizeof(head)) / sizeof(uint32_t) ||
+        body_size != 2 * sizeof(uint64_t) + count * sizeof(uint32_t) || prev >= record)
+      throw std::runtime_error("trajectory_store: corrupt run reservation");
+
+    records.push_back(RunsRecord());
+    RunsRecord& runs = records.back();
+    runs.offset = record;
+    runs.prev = prev;
+    runs.runs.resize(count);
+    readAll(fd, reinterpret_cast<uint8_t*>(runs.runs.data()), count * sizeof(uint32_t), record + sizeof(head));
+    if (!std::is_sorted(runs.runs.begin(), runs.runs.end()))
+      throw std::runtime_error("trajectory_store: corrupt run reservation");
+    record = prev;
+  }
+}
+
+
+} // namespace
+
+
+Writer::Writer() : fd_(-1), run_(0), num_channels_(0), chunk_rows_(0) {}
+
+
+Writer::Writer(const std::string& filename, const int& num_channels, const uint32_t& run, const int& chunk_rows)
+  : fd_(-1)
+{
+  open(filename, num_channels, run, chunk_rows);
+}
+
+
+Writer::~Writer()
+{
+  close();
+}
+
+
+// Open a new file, or continue an existing one so a sweep can collect its
+// runs in one place. The run id is reserved in the file before returning, and
+// opening fails if another writer already reserved it.
+void Writer::open(const std::string& filename, const int& num_channels, const uint32_t& run, const int& chunk_rows)
+{
+  close();
+  run_ = run;
+  num_channels_ = num_channels;
+  chunk_rows_ = chunk_rows;
+  chunks_.clear();
+  buffers_.clear();
+
+  fd_ = ::open(filename.c_str(), O_RDWR | O_CREAT, 0644);
+  if (fd_ < 0)
+    throw std::runtime_error("trajectory_store: unable to open " + filename);
+
+  try
+  {
+    FileLock lock(fd_);
+    struct stat st;
+    fstat(fd_, &st);
+    FileState state;
+    if (st.st_size == 0)
+    {
+      state.end = HEADER_SIZE;
+      state.last_footer = 0;
+      state.last_runs = 0;
+      state.num_chunks = 0;
+      std::vector<uint8_t> header(MAGIC, MAGIC + sizeof(MAGIC));
+      put(header, VERSION);
+      put(header, uint32_t(num_channels_));
+      put(header, state);
+      writeAll(fd_, header.data(), header.size(), 0);
+    }
+    else
+    {
+      uint8_t header[HEADER_SIZE];
+      if (uint64_t(st.st_size) < HEADER_SIZE)
+        throw std::runtime_error("trajectory_store: " + filename + " is not a trajectory file");
+      readAll(fd_, header, HEADER_SIZE, 0);
+      const uint8_t* in = header + sizeof(MAGIC);
+      uint32_t version = get<uint32_t>(in);
+      uint32_t file_channels = get<uint32_t>(in);
+      state = get<FileState>(in);
+      if (memcmp(header, MAGIC, sizeof(MAGIC)) || version != VERSION)
+        throw std::runtime_error("trajectory_store: " + filename + " is not a version " + std::to_string(VERSION) + " trajectory file");
+      if (int(file_channels) != num_channels_)
+        throw std::runtime_error("trajectory_store: channel count does not match existing file " + filename);
+      if (state.end < HEADER_SIZE || state.end > uint64_t(st.st_size))
+        throw std::runtime_error("trajectory_store: corrupt header in " + filename);
+    }
+
+    // Reserve the run. Like a binary counter, the new record absorbs newer
+    // records no larger than itself, so the chain stays logarithmic in length.
+    std::vector<RunsRecord> records;
+    readRuns(fd_, state, records);
+    for (const RunsRecord& r : records)
+      if (std::binary_search(r.runs.begin(), r.runs.end(), run_))
+        throw std::runtime_error("trajectory_store: run " + std::to_string(run_) + " is already in " + filename);
+
+    std::vector<uint32_t> runs(1, run_);
+    size_t merged = 0;
+    for (; merged < records.size() && records[merged].runs.size() <= runs.size(); ++merged)
+    {
+      std::vector<uint32_t> both;
+      std::merge(runs.begin(), runs.end(), records[merged].runs.begin(), records[merged].runs.end(), std::back_inserter(both));
+      runs.swap(both);
+    }
+
+    std::vector<uint8_t> record;
+    put(record, RUNS_TAG);
+    put(record, uint32_t(0));
+    put(record, uint64_t(2 * sizeof(uint64_t) + runs.size() * sizeof(uint32_t)));
+    put(record, merged < records.size() ? records[merged].offset : uint64_t(0));
+    put(record, uint64_t(runs.size()));
+    for (const uint32_t& r : runs)
+      put(record, r);
+    state.last_runs = state.end;
+    commit(fd_, record, state);
+  }
+  catch (...)
+  {
+    ::close(fd_);
+    fd_ = -1;
+    throw;
+  }
+}
+
+
+void Writer::append(const uint32_t& vehicle, const double& t, const Eigen::VectorXd& data)
+{
+  std::vector<std::vector<double>>& columns = buffers_[vehicle];
+  if (columns.empty())
+  {
+    columns.resize(num_channels_ + 1);
+    for (auto& column : columns)
+      column.reserve(chunk_rows_);
+  }
+
+  columns[0].push_back(t);
+  for (int j = 0; j < num_channels_; ++j)
+    columns[j+1].push_back(data(j));
+
+  if (int(columns[0].size()) >= chunk_rows_)
+    flush(vehicle);
+}
+
+
+// Write out remaining rows and a footer indexing this session's chunks
+void Writer::close()
+{
+  if (fd_ < 0)
+    return;
+
+  for (auto& buffer : buffers_)
+    flush(buffer.first);
+
+  if (!chunks_.empty())
+  {
+    std::vector<uint8_t> footer;
+    encodeFooter(chunks_, num_channels_, footer);
+    FileLock lock(fd_);
+    FileState state = readState(fd_);
+    memcpy(footer.data() + RECORD_HEADER_SIZE, &state.last_footer, sizeof(uint64_t));
+    state.last_footer = state.end;
+    commit(fd_, footer, state);
+  }
+
+  ::close(fd_);
+  fd_ = -1;
+  chunks_.clear();
+  buffers_.clear();
+}
+
+
+void Writer::flush(const uint32_t& vehicle)
+{
+  std::vector<std::vector<double>>& columns = buffers_[vehicle];
+  if (columns.empty() || columns[0].empty())
+    return;
+
+  ChunkInfo chunk;
+  chunk.run = run_;
+  chunk.vehicle = vehicle;
+  chunk.num_rows = columns[0].size();
+  chunk.t_min = columns[0].front();
+  chunk.t_max = columns[0].back();
+
+  std::vector<std::vector<uint8_t>> blocks(columns.size());
+  uint64_t body_size = chunkHeaderSize(num_channels_);
+  for (size_t j = 0; j < columns.size(); ++j)
+  {
+    if (j == 0)
+      encodeTime(columns[j], blocks[j]);
+    else
+      encodeXor(columns[j], blocks[j]);
+    chunk.sizes.push_back(blocks[j].size());
+    body_size += blocks[j].size();
+    columns[j].clear();
+  }
+
+  std::vector<uint8_t> record;
+  record.reserve(RECORD_HEADER_SIZE + body_size);
+  put(record, CHUNK_TAG);
+  put(record, uint32_t(0));
+  put(record, body_size);
+  encodeChunkHeader(chunk, record);
+  for (const std::vector<uint8_t>& block : blocks)
+    record.insert(record.end(), block.begin(), block.end());
+
+  uint64_t offset;
+  {
+    FileLock lock(fd_);
+    FileState state = readState(fd_);
+    ++state.num_chunks;
+    offset = commit(fd_, record, state) + RECORD_HEADER_SIZE + chunkHeaderSize(num_channels_);
+  }
+  for (const uint64_t& size : chunk.sizes)
+  {
+    chunk.offsets.push_back(offset);
+    offset += size;
+  }
+  chunks_.push_back(chunk);
+}
+
+
+Reader::Reader() : data_(nullptr), size_(0), num_channels_(0) {}
+
+
+Reader::Reader(const std::string& filename)
+  : data_(nullptr), size_(0), num_channels_(0)
+{
+  open(filename);
+}
+
+
+Reader::~Reader()
+{
+  close();
+}
+
+
+void Reader::open(const std::string& filename)
+{
+  close();
+
+  int fd = ::open(filename.c_str(), O_RDONLY);
+  if (fd < 0)
+    throw std::runtime_error("trajectory_store: unable to open " + filename);
+  struct stat st;
+  fstat(fd, &st);
+  size_ = st.st_size;
+  void* map = size_ > 0 ? mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+  ::close(fd);
+  if (map == MAP_FAILED)
+    throw std::runtime_error("trajectory_store: unable to map " + filename);
+  data_ = static_cast<const uint8_t*>(map);
+
+  try
+  {
+    loadIndex(data_, size_, num_channels_, chunks_);
+  }
+  catch (...)
+  {
+    close();
+    throw;
+  }
+
+  // Running maximum of t_max within each run and vehicle, so find() can
+  // binary search for the first chunk reaching a time even if chunks overlap
+  t_reach_.resize(chunks_.size());
+  for (size_t i = 0; i < chunks_.size(); ++i)
+  {
+    bool same = i > 0 && chunks_[i].run == chunks_[i-1].run && chunks_[i].vehicle == chunks_[i-1].vehicle;
+    t_reach_[i] = same ? std::max(t_reach_[i-1], chunks_[i].t_max) : chunks_[i].t_max;
+  }
+}
+
+
+void Reader::close()
+{
+  if (data_ != nullptr)
+    munmap(const_cast<uint8_t*>(data_), size_);
+  data_ = nullptr;
+  size_ = 0;
+  chunks_.clear();
+  t_reach_.clear();
+}
+
+
+// Chunks of one vehicle of one run overlapping a time range, in start time order
+std::vector<int> Reader::find(const uint32_t& run, const uint32_t& vehicle, const double& t_min, const double& t_max) const
+{
+  auto key = std::make_pair(run, vehicle);
+  auto first = std::lower_bound(chunks_.begin(), chunks_.end(), key, [](const ChunkInfo& c, const std::pair<uint32_t, uint32_t>& k)
+                                { return std::make_pair(c.run, c.vehicle) < k; });
+  auto last = std::upper_bound(first, chunks_.end(), key, [](const std::pair<uint32_t, uint32_t>& k, const ChunkInfo& c)
+                               { return k < std::make_pair(c.run, c.vehicle); });
+  size_t begin = std::lower_bound(t_reach_.begin() + (first - chunks_.begin()), t_reach_.begin() + (last - chunks_.begin()), t_min) - t_reach_.begin();
+
+  std::vector<int> ids;
+  for (size_t i = begin; i < size_t(last - chunks_.begin()) && chunks_[i].t_min <= t_max; ++i)
+    if (chunks_[i].t_max >= t_min)
+      ids.push_back(i);
+  return ids;
+}
+
+
+const uint8_t* Reader::columnData(const int& chunk, const int& column, uint64_t& size) const
+{
+  size = chunks_[chunk].sizes[column];
+  return data_ + chunks_[chunk].offsets[column];
+}
+
+
+void Reader::column(const int& chunk, const int& column, std::vector<double>& values) const
+{
+  values.resize(chunks_[chunk].num_rows);
+  const uint8_t* in = data_ + chunks_[chunk].offsets[column];
+  if (column == 0)
+    decodeTime(in, chunks_[chunk].num_rows, values.data());
+  else
+    decodeXor(in, chunks_[chunk].num_rows, values.data());
+}
+
+
+// Collect rows of [t, channels...] for one vehicle of one run within a time range,
+// ordered by chunk start time
+void Reader::read(const uint32_t& run, const uint32_t& vehicle, const double& t_min, const double& t_max, Eigen::MatrixXd& rows) const
+{
+  std::vector<int> ids = find(run, vehicle, t_min, t_max);
+  std::vector<double> t, values;
+  std::vector<std::pair<int, int>> ranges; // first row and row count kept from each chunk
+  int num_rows = 0;
+  for (int id : ids)
+  {
+    column(id, 0, t);
+    int first = std::lower_bound(t.begin(), t.end(), t_min) - t.begin();
+    int last = std::upper_bound(t.begin(), t.end(), t_max) - t.begin();
+    ranges.push_back(std::make_pair(first, last - first));
+    num_rows += last - first;
+  }
+
+  rows.resize(num_rows, num_channels_ + 1);
+  for (int j = 0; j <= num_channels_; ++j)
+  {
+    int row = 0;
+    for (size_t k = 0; k < ids.size(); ++k)
+    {
+      column(ids[k], j, values);
+      rows.col(j).segment(row, ranges[k].second) =
+          Eigen::Map<Eigen::VectorXd>(values.data() + ranges[k].first, ranges[k].second);
+      row += ranges[k].second;
+    }
+  }
+}
+
+
+} // namespace trajectory_store
@@ -0,0 +1,212 @@
+#include <tuple>
+#include "wind_field.h"
+
+namespace environment
+{
+
+
+namespace
+{
+
+
+uint64_t mix(uint64_t x)
+{
+  // splitmix64 finalizer
+  x += 0x9e3779b97f4a7c15ull;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+  return x ^ (x >> 31);
+}
+
+
+} // namespace
+
+
+WindField::WindField()
+  : enabled_(false), seed_(0), generation_(0), num_terms_(1), alpha_(0), alpha_tail_(0), scale_(1), rho_(0)
+{
+  vw_mean_.setZero();
+}
+
+
+WindField::WindField(const std::string &filename, std::default_random_engine& rng)
+  : enabled_(false), generation_(0)
+{
+  load(filename, rng);
+}
+
+
+WindField::~WindField() {}
+
+
+void WindField::load(const std::string &filename, std::default_random_engine& rng)
+{
+  // Load all parameters
+  Eigen::Vector3d vw_init;
+  common::get_yaml_node("enable_wind", filename, enabled_);
+  common::get_yaml_node("wind_tile_size", filename, tile_size_);
+  common::get_yaml_node("wind_correlation_time", filename, tau_);
+  common::get_yaml_node("wind_time_step", filename, h_);
+  common::get_yaml_node("wind_north_init_stdev", filename, init_stdev_(0));
+  common::get_yaml_node("wind_east_init_stdev", filename, init_stdev_(1));
+  common::get_yaml_node("wind_down_init_stdev", filename, init_stdev_(2));
+  common::get_yaml_node("wind_north_walk_stdev", filename, walk_stdev_(0));
+  common::get_yaml_node("wind_east_walk_stdev", filename, walk_stdev_(1));
+  common::get_yaml_node("wind_down_walk_stdev", filename, walk_stdev_(2));
+  common::get_yaml_eigen<Eigen::Vector3d>("wind_init_vector", filename, vw_init);
+
+  // Draw the global mean wind and the seed all node noise is hashed from
+  std::normal_distribution<double> dist(0.0, 1.0);
+  vw_mean_.setZero();
+  if (enabled_)
+  {
+    for (int i = 0; i < 3; ++i)
+      vw_mean_(i) = vw_init(i) + init_stdev_(i) * dist(rng);
+  }
+  seed_ = (uint64_t(rng()) << 32) ^ rng();
+
+  // Truncate the Gauss-Markov sum once its weights fall below exp(-10)
+  alpha_ = exp(-h_ / tau_);
+  num_terms_ = std::ceil(10.0 * tau_ / h_) + 1;
+  alpha_tail_ = pow(alpha_, num_terms_);
+  double sum_sq = (1.0 - alpha_tail_ * alpha_tail_) / (1.0 - alpha_ * alpha_);
+  scale_ = 1.0 / sqrt(sum_sq);
+  rho_ = alpha_ * (1.0 - alpha_tail_ * alpha_tail_ / (alpha_ * alpha_)) / (1.0 - alpha_tail_ * alpha_tail_);
+
+  nodes_.clear();
+  ++generation_;
+}
+
+
+Eigen::Vector3d WindField::sample(const double &t, const Eigen::Vector3d& p, Tile& tile)
+{
+  if (!enabled_)
+    return Eigen::Vector3d::Zero();
+
+  // Tile containing the sample point and its fractional position in the tile
+  double gi = p(0) / tile_size_;
+  double gj = p(1) / tile_size_;
+  int i = std::floor(gi);
+  int j = std::floor(gj);
+  double a = gi - i;
+  double b = gj - j;
+
+  // Time bin and fractional position in the bin
+  double gk = t / h_;
+  int64_t k = std::floor(gk);
+  double c = gk - k;
+
+  // Generate or look up the tile corners only when the vehicle changes tile
+  if (tile.corners[0] == nullptr || i != tile.i || j != tile.j || tile.generation != generation_)
+  {
+    tile.i = i;
+    tile.j = j;
+    tile.generation = generation_;
+    tile.corners[0] = &node(i, j, k);
+    tile.corners[1] = &node(i+1, j, k);
+    tile.corners[2] = &node(i, j+1, k);
+    tile.corners[3] = &node(i+1, j+1, k);
+  }
+
+  // Blend the corners, renormalized since independent nodes average toward zero
+  const double w[4] = {(1 - a) * (1 - b), a * (1 - b), (1 - a) * b, a * b};
+  double w_sq = 0;
+  Eigen::Vector3d dv0 = Eigen::Vector3d::Zero(), dv1 = Eigen::Vector3d::Zero();
+  for (int n = 0; n < 4; ++n)
+  {
+    Node& corner = *tile.corners[n];
+    std::lock_guard<std::mutex> lock(corner.mutex);
+    advance(corner, k);
+    dv0 += w[n] * corner.v0;
+    dv1 += w[n] * corner.v1;
+    w_sq += w[n] * w[n];
+  }
+
+  // Same in time, where consecutive bins are correlated by rho
+  double t_var = (1 - c) * (1 - c) + c * c + 2 * c * (1 - c) * rho_;
+  return vw_mean_ + ((1 - c) * dv0 + c * dv1) / sqrt(w_sq * t_var);
+}
+
+
+// Look up a node, evaluating new ones outside the lock. When two vehicles
+// create the same node at once, both evaluate it and the first insert wins.
+WindField::Node& WindField::node(const int &i, const int &j, const int64_t &k)
+{
+  uint64_t key = (uint64_t(uint32_t(i)) << 32) | uint32_t(j);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = nodes_.find(key);
+    if (it != nodes_.end())
+      return it->second;
+  }
+
+  Eigen::Vector3d v0 = deviation(i, j, k);
+  Eigen::Vector3d v1 = deviation(i, j, k + 1);
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto inserted = nodes_.emplace(std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple());
+  Node& n = inserted.first->second;
+  if (inserted.second)
+  {
+    n.i = i;
+    n.j = j;
+    n.k = k;
+    n.v0 = v0;
+    n.v1 = v1;
+  }
+  return n;
+}
+
+
+// Move a node forward to bin k, stepping the truncated sum or restarting it after long idles
+void WindField::advance(Node& n, const int64_t &k) const
+{
+  if (k == n.k)
+    return;
+  if (k < n.k || k - n.k > num_terms_)
+  {
+    n.k = k;
+    n.v0 = deviation(n.i, n.j, k);
+    n.v1 = deviation(n.i, n.j, k + 1);
+    return;
+  }
+
+  while (n.k < k)
+  {
+    ++n.k;
+    n.v0 = n.v1;
+    for (int axis = 0; axis < 3; ++axis)
+      n.v1(axis) = alpha_ * n.v1(axis) + walk_stdev_(axis) * scale_ *
+                   (noise(n.i, n.j, n.k + 1, axis) - alpha_tail_ * noise(n.i, n.j, n.k + 1 - num_terms_, axis));
+  }
+}
+
+
+// Node deviation at bin k evaluated directly from its noise history
+Eigen::Vector3d WindField::deviation(const int &i, const int &j, const int64_t &k) const
+{
+  Eigen::Vector3d v = Eigen::Vector3d::Zero();
+  for (int axis = 0; axis < 3; ++axis)
+  {
+    double weight = 1.0;
+    for (int m = 0; m < num_terms_; ++m)
+    {
+      v(axis) += weight * noise(i, j, k - m, axis);
+      weight *= alpha_;
+    }
+  }
+  return scale_ * walk_stdev_.cwiseProduct(v);
+}
+
+
+// Standard normal sample that depends only on the seed, node, time bin and axis
+double WindField::noise(const int &i, const int &j, const int64_t &k, const int &axis) const
+{
+  uint64_t h = mix(mix(mix(seed_ + ((uint64_t(uint32_t(i)) << 32) | uint32_t(j))) + uint64_t(k)) + axis);
+  double u1 = ((h >> 11) + 0.5) * (1.0 / 9007199254740992.0);
+  double u2 = (mix(h) >> 11) * (1.0 / 9007199254740992.0);
+  return sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+}
+
+
+} // namespace environment